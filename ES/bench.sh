@@ -0,0 +1,105 @@
+#!/bin/bash
+# Thread-scaling benchmark for eco.
+#
+# Runs eco on every world for every thread count, repeating each run, checks
+# the final state and prints the best and mean time with the speedup and
+# efficiency relative to the first thread count.
+#
+# Worlds are either input files in this directory, checked against the
+# matching output* reference, or generated worlds written as gen:RxC:N_GEN
+# with an optional :seed, checked against the run with the first thread
+# count. Exits with status 1 if any check fails. CC and CFLAGS select the
+# compiler and extra flags for eco, e.g. CFLAGS=-DSPECIALIZED_KERNELS.
+
+set -u
+
+usage() {
+    cat >&2 <<EOF
+Usage: $0 [-t "<threads>..."] [-r <repetitions>] [-a "<eco arguments>"] [world...]
+  -t  thread counts, default "1 2 4 8"
+  -r  runs per world and thread count, default 3
+  -a  extra arguments for eco, e.g. "--engine strips"
+  world is input<size> (checked against output<size>) or gen:RxC:N_GEN[:seed]
+EOF
+    exit 1
+}
+
+threads="1 2 4 8"
+reps=3
+eco_args=""
+while getopts "t:r:a:h" opt; do
+    case $opt in
+        t) threads=$OPTARG ;;
+        r) reps=$OPTARG ;;
+        a) eco_args=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+here=$(cd "$(dirname "$0")" && pwd)
+worlds=${*:-input5x5 input10x10 input20x20 input100x100 input100x100_unbal01 input100x100_unbal02 input200x200}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+CC=${CC:-gcc}
+$CC -O2 -fopenmp ${CFLAGS:-} -o "$work/eco" "$here/eco.c" || exit 1
+$CC -O2 -o "$work/gen_world" "$here/gen_world.c" || exit 1
+
+failed=0
+printf "%-24s %7s %12s %12s %8s %10s  %s\n" world threads "best (s)" "mean (s)" speedup efficiency check
+for world in $worlds; do
+    case $world in
+        gen:*)
+            IFS=: read -r _ size n_gen seed <<<"$world"
+            input="$work/$world.in"
+            "$work/gen_world" "${size%x*}" "${size#*x}" "$n_gen" --seed "${seed:-1}" >"$input" || exit 1
+            reference=""
+            ;;
+        *)
+            input="$here/$world"
+            reference="$here/output${world#input}"
+            ;;
+    esac
+
+    base=""
+    for t in $threads; do
+        times=""
+        check=OK
+        for ((k = 0; k < reps; k++)); do
+            # eco prints "Execution Time: <seconds> seconds" on stderr
+            time=$(OMP_NUM_THREADS=$t "$work/eco" $eco_args "$input" 2>&1 >"$work/out" |
+                   sed -n 's/^Execution Time: \([0-9.]*\) seconds$/\1/p')
+            if [ -z "$time" ]; then
+                check=FAIL
+                break
+            fi
+            if [ -z "$reference" ]; then
+                # Generated world: the first run is the reference for the rest
+                reference="$work/reference"
+                cp "$work/out" "$reference"
+            fi
+            cmp -s "$work/out" "$reference" || check=DIFF
+            times="$times $time"
+        done
+        if [ "$check" != OK ]; then
+            failed=1
+        fi
+        if [ -z "$times" ]; then
+            printf "%-24s %7d %12s %12s %8s %10s  %s\n" "$world" "$t" - - - - "$check"
+            continue
+        fi
+        read -r best mean <<<"$(echo $times | awk '{ b = $1; s = 0
+            for (i = 1; i <= NF; i++) { s += $i; if ($i < b) b = $i }
+            printf "%.6f %.6f", b, s / NF }')"
+        if [ -z "$base" ]; then
+            base=$best
+            base_threads=$t
+        fi
+        awk -v w="$world" -v t="$t" -v b="$best" -v m="$mean" -v base="$base" -v bt="$base_threads" -v c="$check" \
+            'BEGIN { s = b > 0 ? base / b : 0
+                     printf "%-24s %7d %12.6f %12.6f %8.2f %9.1f%%  %s\n", w, t, b, m, s, 100 * s * bt / t, c }'
+    done
+done
+exit $failed
@@ -1,625 +1,3579 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdbool.h>
-#include <omp.h>
-#include <sys/time.h>
-
-#define MAX_ROWS 100
-#define MAX_COLS 100
-#define MAX_OBJECTS 10000
-#define MAX_STR_SIZE 16
-
-typedef struct {
-    int new_x;
-    int new_y;
-    bool move_requested;
-} Move;
-
-typedef struct {
-    char type; // 'R' for Rabbit, 'F' for Fox, 'X' for Rock
-    int id; // Unique ID for each rabbit and fox
-    int x;
-    int y;
-    int age;
-    int hunger;
-    Move intended_move;
-} Object;
-
-typedef struct {
-    char type[6];
-    int x;
-    int y;
-} TempObject;
-
-int R, C, N_GEN, GEN_PROC_RABBITS, GEN_PROC_FOXES, GEN_FOOD_FOXES,num_objects,id_objetcs;
-int directions[4][2] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
-char ecosystem[MAX_ROWS][MAX_COLS][MAX_STR_SIZE];
-Object objects[MAX_OBJECTS];
-int object_index[MAX_ROWS][MAX_COLS];
-
-void initialize_object_index() {
-    int j;
-    #pragma omp for private(j) collapse(2)
-    for (int i = 0; i < MAX_ROWS; i++) {
-        for (int j = 0; j < MAX_COLS; j++) {
-            object_index[i][j] = -1; // Initialize all positions as empty
-        }
-    }
-    // Set the initial object positions
-    #pragma omp for 
-    for (int i = 0; i < num_objects; i++) {
-        object_index[objects[i].x][objects[i].y] = i;
-    }
-}
-
-void read_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening input file");
-        exit(1);
-    }
-
-    fscanf(file, "%d %d %d %d %d %d %d", &GEN_PROC_RABBITS, &GEN_PROC_FOXES, &GEN_FOOD_FOXES, &N_GEN, &R, &C, &num_objects);
-    id_objetcs=num_objects;
-
-    // Temporary array to store input
-    TempObject temp_objects[MAX_OBJECTS];
-
-      // Read input sequentially into temporary buffer
-    for (int i = 0; i < num_objects; i++) {
-        fscanf(file, "%s %d %d", temp_objects[i].type, &temp_objects[i].x, &temp_objects[i].y);
-    }
-
-    fclose(file);
-
-    memset(ecosystem, '.', sizeof(ecosystem));
-    initialize_object_index();
-
-    // Parallelize object initialization
-    int x=0,y=0;
-    char type[6]="";
-    #pragma omp parallel for private(type,x,y) schedule (dynamic,1)
-    for (int i = 0; i < num_objects; i++) {
-        x = temp_objects[i].x;
-        y = temp_objects[i].y;
-        strcpy(type, temp_objects[i].type);
-        if (strcmp(type, "FOX") == 0) {
-            objects[i] = (Object){'F', i, x, y, 0, 0};
-            snprintf(ecosystem[x][y], MAX_STR_SIZE, "F%d", i);
-        } else if (strcmp(type, "RABBIT") == 0) {
-            objects[i] = (Object){'R', i, x, y, 0, 0};
-            snprintf(ecosystem[x][y], MAX_STR_SIZE, "R%d", i);
-        } else if (strcmp(type, "ROCK") == 0) {
-            objects[i] = (Object){'X', i, x, y, 0, 0};
-            snprintf(ecosystem[x][y], MAX_STR_SIZE, "X");
-        }
-
-        object_index[x][y] = i; // Update the index map
-    }
-
-}
-
-void print_ecosystem_compact() {
-    printf("----------------------\n");
-    for (int i = 0; i < R; i++) {
-        for (int j = 0; j < C; j++) {
-            printf("+------+");
-        }
-        printf("\n");
-        for (int j = 0; j < C; j++) {
-            printf("|");
-            if (ecosystem[i][j][0] == '.') {
-                printf("      ");
-            } else if (ecosystem[i][j][0] == 'X') {
-                printf(" X    ");
-            } else if(ecosystem[i][j][0] == 'R' || ecosystem[i][j][0] == 'F'){
-                int id;
-                sscanf(ecosystem[i][j] + 1, "%d", &id);
-                printf(" %c%-3d ", ecosystem[i][j][0], id);
-            }
-        }
-        printf("|\n");
-    }
-    for (int j = 0; j < C; j++) {
-        printf("+------+");
-    }
-    printf("\n----------------------\n");
-}
-
-void print_ecosystem() {
-    // Print horizontal divider at the top of the grid
-    for (int j = 0; j < C + 2; j++) {
-        printf("-");
-    }
-    printf("   ");
-    for (int j = 0; j < C + 2; j++) {
-        printf("-");
-    }
-    printf("   ");
-    for (int j = 0; j < C + 2; j++) {
-        printf("-");
-    }
-    printf("\n");
-
-    for (int i = 0; i < R; i++) {
-        // First matrix - Object types
-        printf("|"); // Left edge
-        for (int j = 0; j < C; j++) {
-            if (ecosystem[i][j][0] == '.') {
-                printf(" "); // Empty cell
-            } else if (ecosystem[i][j][0] == 'X') {
-                printf("*"); // Replace 'X' with '*'
-            } else {
-                printf("%c", ecosystem[i][j][0]); // Print object type (R, F, etc.)
-            }
-        }
-        printf("|"); // Right edge
-
-        // Second matrix: Object ages
-        printf("   |");
-        for (int j = 0; j < C; j++) {
-            int obj_index = object_index[i][j];
-            if (obj_index == -1 || objects[obj_index].type == 'D') {
-                printf(" "); // Empty cell or dead object
-            } else if (objects[obj_index].type == 'X') {
-                printf("*"); // Rocks don't have age
-            } else {
-                printf("%d", objects[obj_index].age % 10); // Print age as single digit
-            }
-        }
-        printf("|"); // Right edge
-
-        // Third matrix: Hunger (Foxes) or 'R' for Rabbits
-        printf("   |");
-        for (int j = 0; j < C; j++) {
-            int obj_index = object_index[i][j];
-            if (obj_index == -1 || objects[obj_index].type == 'D') {
-                printf(" "); // Empty cell or dead object
-            } else if (objects[obj_index].type == 'X') {
-                printf("*"); // Rocks displayed as '*'
-            } else if (objects[obj_index].type == 'R') {
-                printf("R"); // Rabbits
-            } else if (objects[obj_index].type == 'F') {
-                printf("%d", objects[obj_index].hunger ); // Fox hunger as single digit
-            } else {
-                printf(" ");
-            }
-        }
-        printf("|\n"); // Right edge
-    }
-
-    // Print horizontal divider at the bottom of the grid
-    for (int j = 0; j < C + 2; j++) {
-        printf("-");
-    }
-    printf("   ");
-    for (int j = 0; j < C + 2; j++) {
-        printf("-");
-    }
-    printf("   ");
-    for (int j = 0; j < C + 2; j++) {
-        printf("-");
-    }
-    printf("\n");
-}
-
-void print_object(const Object* obj) {
-    printf("\nObject Details:\n");
-    printf("Type: %c\n", obj->type);
-    printf("ID: %d\n", obj->id);
-    printf("Position: (%d, %d)\n", obj->x, obj->y);
-    printf("Age: %d\n", obj->age);
-    printf("Hunger: %d\n", obj->hunger);
-    printf("Intended Move: New Position (%d, %d), Move Requested: %s\n",
-           obj->intended_move.new_x,
-           obj->intended_move.new_y,
-           obj->intended_move.move_requested ? "Yes" : "No");
-}
-
-void print_final_state() {
-    printf("%d %d %d %d %d %d %d\n", GEN_PROC_RABBITS, GEN_PROC_FOXES, GEN_FOOD_FOXES, 0, R, C, num_objects);
-
-    // Print rocks first
-    for (int i = 0; i < num_objects; i++) {
-        if (objects[i].type == 'X') {
-            printf("ROCK %d %d\n", objects[i].x, objects[i].y);
-        }
-    }
-
-    // Print rabbits next
-    for (int i = 0; i < num_objects; i++) {
-        if (objects[i].type == 'R') {
-            printf("RABBIT %d %d\n", objects[i].x, objects[i].y);
-        }
-    }
-
-    // Print foxes last
-    for (int i = 0; i < num_objects; i++) {
-        if (objects[i].type == 'F') {
-            printf("FOX %d %d\n", objects[i].x, objects[i].y);
-        }
-    }
-}
-
-void cleanup_dead_objects() {
-    int active_objects = 0;
-    for (int i = 0; i < num_objects; i++) {
-        if (objects[i].type != 'D') {
-            objects[active_objects++] = objects[i];
-            //printf("Adding Object ID: %d, Type: %c, Position: (%d, %d)\n",objects[i].id, objects[i].type, objects[i].x, objects[i].y);
-        } else {
-            //printf("Removing Object ID: %d, Type: %c, Position: (%d, %d)\n",objects[i].id, objects[i].type, objects[i].x, objects[i].y);
-            object_index[objects[i].x][objects[i].y] = -1; // Clear index
-        }
-    }
-    num_objects = active_objects;
-    //printf("Cleanup complete. Remaining objects: %d\n", num_objects);
-}
-
-void collect_moves_rabbits(int gen) {
-    int valid_cells[4][2]; 
-    int valid_count = 0;   
-    #pragma omp parallel for private(valid_cells, valid_count) schedule(dynamic,1)
-    for (int i = 0; i < num_objects; i++) {
-        Object* obj = &objects[i];
-
-        if (obj->type == 'R') { // Process only rabbits
-            int x = obj->x;
-            int y = obj->y;
-            valid_count = 0; // Reset for each rabbit
-
-            // Check valid moves
-            for (int j = 0; j < 4; j++) {
-                int new_x = x + directions[j][0];
-                int new_y = y + directions[j][1];
-                if (new_x >= 0 && new_x < R && new_y >= 0 && new_y < C && ecosystem[new_x][new_y][0] == '.') {
-                    valid_cells[valid_count][0] = new_x;
-                    valid_cells[valid_count][1] = new_y;
-                    valid_count++;
-                }
-            }
-
-            // Choose a move if available
-            if (valid_count > 0) {
-                int chosen_index = (gen + x + y) % valid_count;
-                obj->intended_move.new_x = valid_cells[chosen_index][0];
-                obj->intended_move.new_y = valid_cells[chosen_index][1];
-                obj->intended_move.move_requested = true;
-            }
-        }
-        //print_object();
-    }
-    
-
-}
-
-void collect_moves_foxes(int gen) {
-    int valid_cells_eat[4][2];
-    int valid_cells[4][2];
-    int valid_count_eat = 0;
-    int valid_count = 0;
-    #pragma omp parallel for private(valid_cells,valid_cells_eat,valid_count,valid_count_eat) schedule(dynamic,1)
-    for (int i= 0; i < num_objects; i++) {
-        Object* obj = &objects[i];
-        if (obj->type == 'F') {
-            int x = obj->x;
-            int y = obj->y;
-            valid_count_eat = 0;
-            valid_count = 0;
-
-            for (int j = 0; j < 4; j++) {
-                int new_x = x + directions[j][0];
-                int new_y = y + directions[j][1];
-                if (new_x >= 0 && new_x < R && new_y >= 0 && new_y < C) {
-                    if (ecosystem[new_x][new_y][0] == 'R') {
-                        valid_cells_eat[valid_count_eat][0] = new_x;
-                        valid_cells_eat[valid_count_eat][1] = new_y;
-                        valid_count_eat++;
-                    } else if (ecosystem[new_x][new_y][0] == '.') {
-                        valid_cells[valid_count][0] = new_x;
-                        valid_cells[valid_count][1] = new_y;
-                        valid_count++;
-                    }
-                }
-            }
-
-            if (valid_count_eat > 0) {
-                int chosen_index = (gen + x + y) % valid_count_eat;
-                obj->intended_move.new_x = valid_cells_eat[chosen_index][0];
-                obj->intended_move.new_y = valid_cells_eat[chosen_index][1];
-                obj->intended_move.move_requested = true;
-            } else if (valid_count > 0) {
-                int chosen_index = (gen + x + y) % valid_count;
-                obj->intended_move.new_x = valid_cells[chosen_index][0];
-                obj->intended_move.new_y = valid_cells[chosen_index][1];
-                obj->intended_move.move_requested = true;
-            }
-            //print_object(obj);
-        }
-    }
-}
-
-void apply_moves_rabbits() {
-    char temp_ecosystem[MAX_ROWS][MAX_COLS][MAX_STR_SIZE];
-    memcpy(temp_ecosystem, ecosystem, sizeof(ecosystem));
-    int old_x,old_y,new_x,new_y;
-    #pragma omp parallel for private(old_x, old_y, new_x, new_y) schedule(dynamic, 1)
-    for (int i = 0; i < num_objects; i++) {
-        Object* obj = &objects[i];
-        if (obj->type == 'R' && obj->intended_move.move_requested) {
-            old_x = obj->x;
-            old_y = obj->y;
-            new_x = obj->intended_move.new_x;
-            new_y = obj->intended_move.new_y;
-
-            // Update positions
-            #pragma omp critical
-            {
-                object_index[old_x][old_y] = -1; // Clear old position
-                object_index[new_x][new_y] = i;  // Set new position
-            }
-            obj->x = new_x;
-            obj->y = new_y;
-
-            snprintf(temp_ecosystem[new_x][new_y], MAX_STR_SIZE, "R%d", obj->id);
-            snprintf(temp_ecosystem[old_x][old_y], MAX_STR_SIZE, ".");
-            obj->intended_move.move_requested = false;
-
-            // Handle rabbit procreation
-            obj->age++;
-            if (obj->age > GEN_PROC_RABBITS) {
-                obj->age = 0;
-                #pragma omp critical
-                {
-                    id_objetcs++;
-                    objects[num_objects] = (Object){'R', id_objetcs, old_x, old_y, 0, 0};
-                    object_index[old_x][old_y] = num_objects; // Update object_index for new rabbit
-                    snprintf(temp_ecosystem[old_x][old_y], MAX_STR_SIZE, "R%d", id_objetcs);
-                    num_objects++;
-                }
-            }
-        }
-    }
-
-    memcpy(ecosystem, temp_ecosystem, sizeof(ecosystem));
-}
-
-void resolve_conflicts() {
-    // Temporary array to store all conflicts by cell
-    Object**** cell_conflicts;
-    int conflict_counts[MAX_ROWS][MAX_COLS] = {0};
-    // Allocate memory dynamically
-    cell_conflicts = malloc(MAX_ROWS * sizeof(Object***));
-    for (int i = 0; i < MAX_ROWS; i++) {
-        cell_conflicts[i] = malloc(MAX_COLS * sizeof(Object**));
-        for (int j = 0; j < MAX_COLS; j++) {
-            cell_conflicts[i][j] = malloc(MAX_OBJECTS * sizeof(Object*));
-        }
-    }
-    
-
-    // Populate the conflict list for each cell
-    for (int i = 0; i < num_objects; i++) {
-        Object* obj = &objects[i];
-        if (obj->intended_move.move_requested) {
-            int x = obj->intended_move.new_x;
-            int y = obj->intended_move.new_y;
-
-            // Ensure coordinates are within bounds
-            if (x >= 0 && x < R && y >= 0 && y < C) {
-                cell_conflicts[x][y][conflict_counts[x][y]++] = obj;
-            }
-        }
-    }
-
-    // Resolve conflicts in each cell
-    for (int x = 0; x < R; x++) {
-        for (int y = 0; y < C; y++) {
-            if (conflict_counts[x][y] > 1) {
-                //printf("Conflict detected at cell (%d, %d):\n", x, y);
-
-                // Conflicts detected in this cell
-                Object* winner = NULL;
-
-                // Separate rabbits and foxes
-                Object* rabbits[MAX_OBJECTS];
-                Object* foxes[MAX_OBJECTS];
-                int rabbit_count = 0, fox_count = 0;
-
-                for (int i = 0; i < conflict_counts[x][y]; i++) {
-                    Object* obj = cell_conflicts[x][y][i];
-                    //printf("  Object ID: %d, Type: %c, Age: %d, Hunger: %d\n", obj->id, obj->type, obj->age, obj->hunger);
-                    if (obj->type == 'R') {
-                        rabbits[rabbit_count++] = obj;
-                    } else if (obj->type == 'F') {
-                        foxes[fox_count++] = obj;
-                    }
-                }
-
-                // Resolve rabbit conflicts: oldest procreation age wins
-                if (rabbit_count > 0) {
-                    //printf("  Resolving rabbit conflict...\n");
-                    winner = rabbits[0];
-                    for (int i = 1; i < rabbit_count; i++) {
-                        if (rabbits[i]->age > winner->age) {
-                            winner = rabbits[i];
-                        }
-                    }
-                    //printf("  Winner Rabbit ID: %d, Age: %d\n", winner->id, winner->age);
-                    // Mark all other rabbits as inactive
-                    for (int i = 0; i < rabbit_count; i++) {
-                        if (rabbits[i] != winner) {
-                            rabbits[i]->type = 'D'; // Mark as dead
-                            rabbits[i]->intended_move.move_requested = false;
-                            //printf("    Rabbit ID: %d removed.\n", rabbits[i]->id);
-                        }
-                    }
-                }
-
-                // Resolve fox conflicts: oldest procreation age wins
-                if (fox_count > 0) {
-                    //printf("  Resolving fox conflict...\n");
-                    winner = foxes[0];
-                    for (int i = 1; i < fox_count; i++) {
-                        if (foxes[i]->age > winner->age || 
-                           (foxes[i]->age == winner->age && foxes[i]->hunger < winner->hunger)) {
-                            winner = foxes[i];
-                        }
-                    }
-                    //printf("  Winner Fox ID: %d, Age: %d, Hunger: %d\n", winner->id, winner->age, winner->hunger);
-                    // Mark all other foxes as inactive
-                    for (int i = 0; i < fox_count; i++) {
-                        if (foxes[i] != winner) {
-                            foxes[i]->type = 'D'; // Mark as dead
-                            foxes[i]->intended_move.move_requested = false;
-                            //printf("    Fox ID: %d removed.\n", foxes[i]->id);
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // Clean up the objects array (remove all 'D' objects)
-    int active_objects = 0;
-    for (int i = 0; i < num_objects; i++) {
-        if (objects[i].type != 'D') {
-            // Keep the active object
-            objects[active_objects++] = objects[i];
-        } else {
-            // Log the removal of the object
-            //printf("Removing Object ID: %d, Type: %c, Position: (%d, %d)\n",objects[i].id, objects[i].type, objects[i].x, objects[i].y);
-
-            // Clear the object from the object_index
-            object_index[objects[i].x][objects[i].y] = -1;
-
-            // Optionally clear the ecosystem, though it's handled by apply_moves
-            snprintf(ecosystem[objects[i].x][objects[i].y], MAX_STR_SIZE, ".");
-        }
-    }
-    for (int i = 0; i < MAX_ROWS; i++) {
-        for (int j = 0; j < MAX_COLS; j++) {
-            free(cell_conflicts[i][j]);
-        }
-        free(cell_conflicts[i]);
-    }
-    free(cell_conflicts);
-}
-
-void apply_moves_foxes() {
-    char temp_ecosystem[MAX_ROWS][MAX_COLS][MAX_STR_SIZE];
-    memcpy(temp_ecosystem, ecosystem, sizeof(ecosystem));
-    int old_x,old_y,new_x,new_y;
-    #pragma omp parallel for private(old_x, old_y, new_x, new_y) schedule(dynamic, 1)
-    for (int i = 0; i < num_objects; i++) {
-        Object* obj = &objects[i];
-        if (obj->type == 'F' && obj->intended_move.move_requested) {
-            old_x = obj->x;
-            old_y = obj->y;
-            new_x = obj->intended_move.new_x;
-            new_y = obj->intended_move.new_y;
-            obj->hunger++;
-            // Fox eats a rabbit
-            if (temp_ecosystem[new_x][new_y][0] == 'R') {
-                obj->hunger = 0; // Reset hunger
-                #pragma omp critical
-                {
-                    int rabbit_index = object_index[new_x][new_y]; // Get rabbit index using object_index
-                    if (rabbit_index != -1 && objects[rabbit_index].type == 'R') {
-                        objects[rabbit_index].type = 'D'; // Mark rabbit as dead
-                        object_index[new_x][new_y] = -1; // Clear the index for the rabbit
-                        snprintf(temp_ecosystem[new_x][new_y], MAX_STR_SIZE, "."); // Clear the cell
-                        //printf("\nFox %d ate Rabbit at (%d, %d)\n", obj->id, new_x, new_y);
-                    }
-                }
-                
-            }
-
-            // Update hunger and check for starvation
-
-            if (obj->hunger >= GEN_FOOD_FOXES) {
-                #pragma omp critical
-                {
-                    obj->type = 'D'; // Mark as dead
-                    object_index[old_x][old_y] = -1; // Clear the index
-                    snprintf(temp_ecosystem[old_x][old_y], MAX_STR_SIZE, ".");
-                    //printf("Fox %d starved and died at (%d, %d)\n", obj->id, old_x, old_y);
-                }
-                continue;
-            }
-
-            #pragma omp critical
-            {
-                // Update positions
-                object_index[old_x][old_y] = -1; // Clear old position
-                object_index[new_x][new_y] = i;  // Set new position
-            }
-            obj->x = new_x;
-            obj->y = new_y;
-
-            snprintf(temp_ecosystem[new_x][new_y], MAX_STR_SIZE, "F%d", obj->id);
-            snprintf(temp_ecosystem[old_x][old_y], MAX_STR_SIZE, ".");
-
-            obj->intended_move.move_requested = false;
-
-            // Handle fox procreation
-            obj->age++;
-            if (obj->age > GEN_PROC_FOXES) {
-                obj->age = 0;
-                #pragma omp critical
-                {
-                    id_objetcs++;
-                    objects[num_objects] = (Object){'F', id_objetcs, old_x, old_y, 0, 0};
-                    object_index[old_x][old_y] = num_objects; // Update object_index for new fox
-                    snprintf(temp_ecosystem[old_x][old_y], MAX_STR_SIZE, "F%d", id_objetcs);
-                    //printf("\nFox %d procreated at (%d, %d)\n", obj->id, old_x, old_y);
-                    num_objects++;
-                }
-            }
-        }
-    }
-
-    cleanup_dead_objects();
-    memcpy(ecosystem, temp_ecosystem, sizeof(ecosystem));
-}
-
-void simulate_generation(int gen) {
-    collect_moves_rabbits(gen);
-    resolve_conflicts();
-    apply_moves_rabbits();
- 
-    collect_moves_foxes(gen);
-    resolve_conflicts();
-    apply_moves_foxes();
-}
-
-
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
-        return 1;
-    }
-
-    read_input(argv[1]);
-    //printf("Generation 0\n");
-    //print_ecosystem();
-
-    struct timeval start_time, end_time;
-    gettimeofday(&start_time, NULL); // Start wall-clock time measurement
-
-    for (int gen = 0; gen < N_GEN; gen++) {
-        simulate_generation(gen);
-        //printf("Generation %d\n", gen + 1);
-        //print_ecosystem();
-    }
-
-    gettimeofday(&end_time, NULL); // End wall-clock time measurement
-
-    // Calculate elapsed time
-    double elapsed_time = (end_time.tv_sec - start_time.tv_sec) + 
-                          (end_time.tv_usec - start_time.tv_usec) / 1e6;
-    printf("Execution Time: %.6f seconds\n", elapsed_time);
-
-    return 0;
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+// Built without OpenMP: the pragmas are ignored and everything runs on
+// one thread
+static inline int omp_get_thread_num(void) { return 0; }
+static inline int omp_get_num_threads(void) { return 1; }
+static inline int omp_get_max_threads(void) { return 1; }
+static inline void omp_set_num_threads(int n) { (void)n; }
+static inline void omp_set_max_active_levels(int n) { (void)n; }
+static inline double omp_get_wtime(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+#endif
+
+// Bump allocator for memory that is released all at once, such as the
+// grids and species of a strip for one round. Allocations are carved out
+// of one buffer; the ones that do not fit go to malloc, and the next reset
+// grows the buffer to the most any round needed, so later rounds get their
+// memory, already paged in, without calling the system allocator.
+typedef struct {
+    char *base;
+    size_t size;           // bytes in base
+    size_t used;           // bytes handed out since the last reset, spills included
+    size_t peak;           // most bytes used between two resets
+    void **spills;         // blocks from malloc that did not fit in base
+    int spill_count;
+    int spill_capacity;
+} Arena;
+
+// Structure-of-arrays storage for one species. Entries [0, count) are the
+// live animals; every phase walks these arrays directly instead of testing
+// the type of every object in the world.
+typedef struct {
+    int count;
+    int capacity;
+    int *x;
+    int *y;
+    int *age;              // generations since birth or last procreation
+    int *hunger;           // generations since the last meal (foxes only)
+    int *id;               // unique id, shown by print_ecosystem_compact
+    int *slot;             // identity table slot, valid while a table is attached
+    int *new_x;            // intended move, valid when move_requested is set
+    int *new_y;
+    bool *move_requested;
+    bool *dead;            // set by conflicts, starvation or predation
+    long age_sum;          // total age of the live animals, kept by compaction
+    Arena *arena;          // owner of the arrays, NULL when they come from malloc
+} Species;
+
+// Events of the last generation, counted by the apply phases
+typedef struct {
+    int rabbit_births;
+    int fox_births;
+    int rabbits_eaten;
+    int foxes_starved;
+    int rabbit_conflict_deaths;
+    int fox_conflict_deaths;
+} GenerationStats;
+
+// Phases of a sub-generation timed by the profiler
+enum { PHASE_COLLECT, PHASE_RESOLVE, PHASE_APPLY, PHASE_CLEANUP, NUM_PHASES };
+
+// One stretch of work of a thread, for the timeline trace
+typedef struct {
+    int phase;
+    double start, end;
+} TraceEvent;
+
+// Per-thread timers, padded so threads never share a cache line
+typedef struct {
+    double busy[NUM_PHASES];   // seconds spent working in each phase
+    TraceEvent *events;        // NULL unless tracing
+    int event_count;
+    int event_capacity;
+    char padding[64];
+} ProfileThread;
+
+typedef struct {
+    int nthreads;
+    bool tracing;
+    double origin;             // omp_get_wtime() when profiling started
+    double wall[NUM_PHASES];   // elapsed time of each phase on the calling thread
+    ProfileThread *threads;
+} Profiler;
+
+// Slot map giving animals a handle that survives compaction. Every live
+// animal owns a slot holding its current species and index; compaction
+// and births keep the slots up to date, and the slots of dead animals go
+// on a free list for newborns. Each reuse bumps the slot's version, so a
+// handle to an animal that died no longer resolves. The handle given to
+// every id is also kept, so animals are found by id in constant time,
+// including those born during the run.
+typedef struct {
+    int slot;
+    unsigned version;
+} AnimalHandle;
+
+typedef struct {
+    int capacity;
+    int *index;            // slot -> index in its species, -1 when free
+    unsigned *version;     // slot -> bumped every time the slot is freed
+    char *kind;            // slot -> 'R' or 'F'
+    int *free_slots;       // stack of free slots
+    int free_count;
+    int id_capacity;
+    AnimalHandle *by_id;   // id -> handle of the animal given that id, slot -1 if none
+} IdentityTable;
+
+// A World holds rows [row_lo, row_hi) of an R x C ecosystem plus one ghost
+// row on each side, so its grids start at row_base = row_lo - 1. The whole
+// world owns rows [0, R); a strip of the domain decomposition owns a slice.
+typedef struct {
+    int R, C, N_GEN;
+    int GEN_PROC_RABBITS, GEN_PROC_FOXES, GEN_FOOD_FOXES;
+    int row_lo, row_hi;    // rows owned by this world
+    int row_base, rows;    // first row stored and number of rows stored
+    int num_rocks;
+    int id_objetcs;        // last id handed out
+    int id_stride;         // distance between ids handed out, keeps strips disjoint
+    bool colored;          // resolve conflicts with the 5-color sweep
+    char *ecosystem;       // rows*C cells: '.', 'X' (rock), 'R' or 'F'
+    int *object_index;     // rows*C index of the occupant in its species, -1 if none
+    int *claims;           // rows*C index of the best mover targeting a cell, -1 if none
+    int tile_cols;         // TILE x TILE tiles per row of tiles
+    int *tile_count;       // non-empty cells of every tile of the owned rows
+    Species rabbits;
+    Species foxes;
+    Species spare;         // scatter target for cleanup_dead_objects
+    GenerationStats stats;
+    Profiler *profile;     // phase timers, NULL when not profiling
+    Arena *arena;          // owner of the grids and species, NULL when they come from malloc
+    IdentityTable *identity; // handles of the animals, NULL when not tracking them
+    int *thread_offsets;   // per-thread survivor or birth counts, then their prefix sum
+    int *birth_cells;      // cells left to newborns, each thread in its block of parents
+    int birth_capacity;    // entries in birth_cells
+} World;
+
+#define CELL(w, x, y) CELL_C(w, (w)->C, x, y)
+// CELL for a width known to the caller, possibly at compile time
+#define CELL_C(w, C, x, y) (((x) - (w)->row_base) * (C) + (y))
+
+// Occupancy is tracked per TILE x TILE block of owned cells, starting at
+// row_lo, so passes over the whole grid can skip the empty parts of
+// sparse worlds
+#define TILE 8
+#define TILE_OF(w, x, y) (((x) - (w)->row_lo) / TILE * (w)->tile_cols + (y) / TILE)
+
+// Row and column steps of the directions N, E, S, W
+#define STEP_X(d) (((d) == 2) - ((d) == 0))
+#define STEP_Y(d) (((d) == 1) - ((d) == 3))
+
+void *xmalloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr && size > 0) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", size);
+        exit(1);
+    }
+    return ptr;
+}
+
+void *xrealloc(void *ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (!ptr && size > 0) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", size);
+        exit(1);
+    }
+    return ptr;
+}
+
+#define ARENA_ALIGN 64
+
+void arena_init(Arena *a) {
+    memset(a, 0, sizeof(*a));
+}
+
+void *arena_alloc(Arena *a, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    size_t offset = a->used;
+    a->used += size;
+    if (a->used <= a->size) {
+        return a->base + offset;
+    }
+    if (a->spill_count == a->spill_capacity) {
+        a->spill_capacity = a->spill_capacity ? 2 * a->spill_capacity : 16;
+        a->spills = realloc(a->spills, a->spill_capacity * sizeof(void *));
+        if (!a->spills) {
+            perror("Memory allocation failed");
+            exit(1);
+        }
+    }
+    void *ptr = aligned_alloc(ARENA_ALIGN, size);
+    if (!ptr && size > 0) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", size);
+        exit(1);
+    }
+    a->spills[a->spill_count++] = ptr;
+    return ptr;
+}
+
+// Release everything handed out since the last reset
+void arena_reset(Arena *a) {
+    for (int k = 0; k < a->spill_count; k++) {
+        free(a->spills[k]);
+    }
+    a->spill_count = 0;
+    a->peak = a->used > a->peak ? a->used : a->peak;
+    if (a->peak > a->size) {
+        free(a->base);
+        a->base = aligned_alloc(ARENA_ALIGN, a->peak);
+        if (!a->base) {
+            fprintf(stderr, "Out of memory allocating %zu bytes\n", a->peak);
+            exit(1);
+        }
+        a->size = a->peak;
+    }
+    a->used = 0;
+}
+
+void arena_free(Arena *a) {
+    arena_reset(a);
+    free(a->base);
+    free(a->spills);
+}
+
+// Allocation from the arena when there is one
+static inline void *arena_xmalloc(Arena *arena, size_t size) {
+    return arena ? arena_alloc(arena, size) : xmalloc(size);
+}
+
+void species_init(Species *s, int capacity, Arena *arena) {
+    s->count = 0;
+    s->age_sum = 0;
+    s->capacity = capacity;
+    s->arena = arena;
+    s->x = arena_xmalloc(arena, capacity * sizeof(int));
+    s->y = arena_xmalloc(arena, capacity * sizeof(int));
+    s->age = arena_xmalloc(arena, capacity * sizeof(int));
+    s->hunger = arena_xmalloc(arena, capacity * sizeof(int));
+    s->id = arena_xmalloc(arena, capacity * sizeof(int));
+    s->slot = arena_xmalloc(arena, capacity * sizeof(int));
+    s->new_x = arena_xmalloc(arena, capacity * sizeof(int));
+    s->new_y = arena_xmalloc(arena, capacity * sizeof(int));
+    s->move_requested = arena_xmalloc(arena, capacity * sizeof(bool));
+    s->dead = arena_xmalloc(arena, capacity * sizeof(bool));
+}
+
+void species_free(Species *s) {
+    if (s->arena) {
+        return;
+    }
+    free(s->x);
+    free(s->y);
+    free(s->age);
+    free(s->hunger);
+    free(s->id);
+    free(s->slot);
+    free(s->new_x);
+    free(s->new_y);
+    free(s->move_requested);
+    free(s->dead);
+}
+
+// Move s to arrays for capacity animals, keeping the first s->count
+void species_grow(Species *s, int capacity) {
+    Species old = *s;
+    species_init(s, capacity, old.arena);
+    size_t n = old.count;
+    s->count = old.count;
+    s->age_sum = old.age_sum;
+    memcpy(s->x, old.x, n * sizeof(int));
+    memcpy(s->y, old.y, n * sizeof(int));
+    memcpy(s->age, old.age, n * sizeof(int));
+    memcpy(s->hunger, old.hunger, n * sizeof(int));
+    memcpy(s->id, old.id, n * sizeof(int));
+    memcpy(s->slot, old.slot, n * sizeof(int));
+    memcpy(s->new_x, old.new_x, n * sizeof(int));
+    memcpy(s->new_y, old.new_y, n * sizeof(int));
+    memcpy(s->move_requested, old.move_requested, n * sizeof(bool));
+    memcpy(s->dead, old.dead, n * sizeof(bool));
+    species_free(&old);
+}
+
+// Capacity for count animals with room to spare, so that a growing
+// population does not reallocate every generation
+static inline int species_headroom(int count) {
+    return count + count / 2 + 16;
+}
+
+// Make room for count animals. Species are sized from the population
+// rather than the grid: rabbits and foxes together never outnumber the
+// cells, but until compaction a species also holds its newborns and the
+// dead entries of conflict losers, so they grow here when needed. Only
+// call this where no other thread is using s.
+void species_reserve(Species *s, int count) {
+    if (count > s->capacity) {
+        species_grow(s, species_headroom(count));
+    }
+}
+
+// Append an animal and return its index. The caller owns the grid update.
+int species_add(Species *s, int id, int x, int y) {
+    species_reserve(s, s->count + 1);
+    int i = s->count++;
+    s->x[i] = x;
+    s->y[i] = y;
+    s->age[i] = 0;
+    s->hunger[i] = 0;
+    s->id[i] = id;
+    s->move_requested[i] = false;
+    s->dead[i] = false;
+    return i;
+}
+
+// Own rows [row_lo, row_hi); must be set before world_alloc
+void world_set_rows(World *w, int row_lo, int row_hi) {
+    w->row_lo = row_lo;
+    w->row_hi = row_hi;
+    w->row_base = row_lo - 1;
+    w->rows = row_hi - row_lo + 2;
+}
+
+// Make w own part `part` of `nparts` horizontal strips of the world. The
+// whole world is part 0 of 1. Expects id_objetcs to hold the last input id.
+void world_layout(World *w, int part, int nparts) {
+    world_set_rows(w, (int)((long)w->R * part / nparts), (int)((long)w->R * (part + 1) / nparts));
+    // Part k hands out ids k+1, k+1+nparts, ... past the last input id
+    w->id_stride = nparts;
+    w->id_objetcs += part + 1 - nparts;
+}
+
+// Allocate the grids and species for w->rows rows starting at w->row_base,
+// from arena if not NULL
+void world_alloc_in(World *w, Arena *arena) {
+    int cells = w->rows * w->C;
+    w->arena = arena;
+    w->ecosystem = arena_xmalloc(arena, cells);
+    w->object_index = arena_xmalloc(arena, cells * sizeof(int));
+    w->claims = arena_xmalloc(arena, cells * sizeof(int));
+    w->tile_cols = (w->C + TILE - 1) / TILE;
+    w->tile_count = arena_xmalloc(arena, (size_t)((w->row_hi - w->row_lo + TILE - 1) / TILE) * w->tile_cols *
+                                         sizeof(int));
+    // First touch places the pages of every band of rows on the node of the
+    // thread that simulates it; inside a strip this is the strip's thread
+    #pragma omp parallel for schedule(static)
+    for (int x = 0; x < w->rows; x++) {
+        memset(&w->ecosystem[x * w->C], '.', w->C);
+        for (int y = 0; y < w->C; y++) {
+            w->object_index[x * w->C + y] = -1;
+            w->claims[x * w->C + y] = -1;
+        }
+    }
+    // The species start empty and grow with the population
+    species_init(&w->rabbits, species_headroom(0), arena);
+    species_init(&w->foxes, species_headroom(0), arena);
+    species_init(&w->spare, species_headroom(0), arena);
+    w->thread_offsets = arena_xmalloc(arena, (omp_get_max_threads() + 1) * sizeof(int));
+    w->birth_cells = NULL;
+    w->birth_capacity = 0;
+    w->profile = NULL;
+    w->identity = NULL;
+    w->num_rocks = 0;
+}
+
+void world_alloc(World *w) {
+    world_alloc_in(w, NULL);
+}
+
+// Size the species of a freshly allocated world for the animals about to
+// be loaded into it
+void world_reserve(World *w, int rabbits, int foxes) {
+    species_reserve(&w->rabbits, rabbits);
+    species_reserve(&w->foxes, foxes);
+    species_reserve(&w->spare, rabbits > foxes ? rabbits : foxes);
+}
+
+// Room for the birth cells of n parents; births never outnumber them
+static void world_reserve_births(World *w, int n) {
+    if (n > w->birth_capacity) {
+        if (!w->arena) {
+            free(w->birth_cells);
+        }
+        w->birth_capacity = species_headroom(n);
+        w->birth_cells = arena_xmalloc(w->arena, w->birth_capacity * sizeof(int));
+    }
+}
+
+// Memory from an arena goes back with the next arena_reset
+void world_free(World *w) {
+    if (w->arena) {
+        return;
+    }
+    free(w->ecosystem);
+    free(w->object_index);
+    free(w->claims);
+    free(w->tile_count);
+    species_free(&w->rabbits);
+    species_free(&w->foxes);
+    species_free(&w->spare);
+    free(w->thread_offsets);
+    free(w->birth_cells);
+}
+
+// Allocate dst as an independent copy of src with the same layout
+void world_copy(World *dst, const World *src) {
+    *dst = *src;
+    world_alloc(dst);
+    world_reserve(dst, src->rabbits.count, src->foxes.count);
+    size_t cells = (size_t)src->rows * src->C;
+    memcpy(dst->ecosystem, src->ecosystem, cells);
+    memcpy(dst->object_index, src->object_index, cells * sizeof(int));
+    memcpy(dst->tile_count, src->tile_count,
+           (size_t)((src->row_hi - src->row_lo + TILE - 1) / TILE) * src->tile_cols * sizeof(int));
+    dst->num_rocks = src->num_rocks;
+    dst->profile = NULL;
+    const Species *from[2] = {&src->rabbits, &src->foxes};
+    Species *to[2] = {&dst->rabbits, &dst->foxes};
+    for (int k = 0; k < 2; k++) {
+        int n = to[k]->count = from[k]->count;
+        to[k]->age_sum = from[k]->age_sum;
+        memcpy(to[k]->x, from[k]->x, n * sizeof(int));
+        memcpy(to[k]->y, from[k]->y, n * sizeof(int));
+        memcpy(to[k]->age, from[k]->age, n * sizeof(int));
+        memcpy(to[k]->hunger, from[k]->hunger, n * sizeof(int));
+        memcpy(to[k]->id, from[k]->id, n * sizeof(int));
+        memset(to[k]->move_requested, 0, n * sizeof(bool));
+        memset(to[k]->dead, 0, n * sizeof(bool));
+    }
+}
+
+// Make room for the handles of ids below `ids`
+static void identity_reserve(IdentityTable *t, int ids) {
+    if (ids <= t->id_capacity) {
+        return;
+    }
+    int capacity = ids > 2 * t->id_capacity ? ids : 2 * t->id_capacity;
+    t->by_id = realloc(t->by_id, capacity * sizeof(AnimalHandle));
+    if (!t->by_id) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (int id = t->id_capacity; id < capacity; id++) {
+        t->by_id[id].slot = -1;
+        t->by_id[id].version = 0;
+    }
+    t->id_capacity = capacity;
+}
+
+// Add slots until at least `needed` of them are free
+static void identity_grow(IdentityTable *t, int needed) {
+    if (t->free_count >= needed) {
+        return;
+    }
+    int capacity = t->capacity + needed - t->free_count;
+    capacity = capacity > 2 * t->capacity ? capacity : 2 * t->capacity;
+    t->index = xrealloc(t->index, capacity * sizeof(int));
+    t->version = xrealloc(t->version, capacity * sizeof(unsigned));
+    t->kind = xrealloc(t->kind, capacity);
+    t->free_slots = xrealloc(t->free_slots, capacity * sizeof(int));
+    // Lowest new slots on top of the stack
+    for (int slot = capacity - 1; slot >= t->capacity; slot--) {
+        t->index[slot] = -1;
+        t->version[slot] = 0;
+        t->free_slots[t->free_count++] = slot;
+    }
+    t->capacity = capacity;
+}
+
+// Give every animal of w a slot and keep them up to date from now on
+void identity_attach(World *w, IdentityTable *t) {
+    t->capacity = w->rabbits.capacity + w->foxes.capacity;
+    t->index = xmalloc(t->capacity * sizeof(int));
+    t->version = xmalloc(t->capacity * sizeof(unsigned));
+    t->kind = xmalloc(t->capacity);
+    t->free_slots = xmalloc(t->capacity * sizeof(int));
+    memset(t->version, 0, t->capacity * sizeof(unsigned));
+    t->id_capacity = 0;
+    t->by_id = NULL;
+    identity_reserve(t, w->id_objetcs + 1);
+    int next = 0;
+    Species *species[2] = {&w->rabbits, &w->foxes};
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < species[k]->count; i++) {
+            species[k]->slot[i] = next;
+            t->index[next] = i;
+            t->kind[next] = k == 0 ? 'R' : 'F';
+            t->by_id[species[k]->id[i]].slot = next;
+            next++;
+        }
+    }
+    // Lowest slots on top of the stack
+    t->free_count = 0;
+    for (int slot = t->capacity - 1; slot >= next; slot--) {
+        t->index[slot] = -1;
+        t->free_slots[t->free_count++] = slot;
+    }
+    w->identity = t;
+}
+
+void identity_detach(World *w) {
+    IdentityTable *t = w->identity;
+    free(t->index);
+    free(t->version);
+    free(t->kind);
+    free(t->free_slots);
+    free(t->by_id);
+    w->identity = NULL;
+}
+
+// Slot for the k-th newborn of a batch, whose id must have been reserved;
+// once the batch is placed, the caller drops its slots from the free list
+static inline int identity_take(IdentityTable *t, int k, char kind, int index, int id) {
+    int slot = t->free_slots[t->free_count - 1 - k];
+    t->index[slot] = index;
+    t->kind[slot] = kind;
+    t->by_id[id].slot = slot;
+    t->by_id[id].version = t->version[slot];
+    return slot;
+}
+
+// Release the slot of a dead animal; safe to call from several threads
+static inline void identity_release(IdentityTable *t, int slot) {
+    t->index[slot] = -1;
+    t->version[slot]++;
+    t->free_slots[__atomic_fetch_add(&t->free_count, 1, __ATOMIC_RELAXED)] = slot;
+}
+
+// Handle given to an id; false if no animal got that id yet
+bool identity_find(const IdentityTable *t, int id, AnimalHandle *h) {
+    if (id < 0 || id >= t->id_capacity || t->by_id[id].slot < 0) {
+        return false;
+    }
+    *h = t->by_id[id];
+    return true;
+}
+
+// Find the animal a handle refers to; false once it has died
+bool identity_lookup(World *w, AnimalHandle h, Species **s, int *i) {
+    const IdentityTable *t = w->identity;
+    if (h.slot < 0 || h.slot >= t->capacity || t->version[h.slot] != h.version || t->index[h.slot] < 0) {
+        return false;
+    }
+    *s = t->kind[h.slot] == 'R' ? &w->rabbits : &w->foxes;
+    *i = t->index[h.slot];
+    return true;
+}
+
+// Size the species arrays of a freshly allocated world for the rabbits
+// and foxes about to be loaded into it and touch them, each thread writing
+// the block of the first animals that the static schedules of the
+// simulation hand it, then its share of the free capacity
+void world_first_touch(World *w, int rabbits, int foxes) {
+    world_reserve(w, rabbits, foxes);
+    Species *species[3] = {&w->rabbits, &w->foxes, &w->spare};
+    int counts[3] = {rabbits, foxes, rabbits > foxes ? rabbits : foxes};
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        for (int k = 0; k < 3; k++) {
+            Species *s = species[k];
+            int n = counts[k];
+            int lo = (int)((long)n * t / nthreads);
+            int hi = (int)((long)n * (t + 1) / nthreads);
+            for (int pass = 0; pass < 2; pass++) {
+                size_t len = hi - lo;
+                memset(&s->x[lo], 0, len * sizeof(int));
+                memset(&s->y[lo], 0, len * sizeof(int));
+                memset(&s->age[lo], 0, len * sizeof(int));
+                memset(&s->hunger[lo], 0, len * sizeof(int));
+                memset(&s->id[lo], 0, len * sizeof(int));
+                memset(&s->slot[lo], 0, len * sizeof(int));
+                memset(&s->new_x[lo], 0, len * sizeof(int));
+                memset(&s->new_y[lo], 0, len * sizeof(int));
+                memset(&s->move_requested[lo], 0, len * sizeof(bool));
+                memset(&s->dead[lo], 0, len * sizeof(bool));
+                lo = n + (int)((long)(s->capacity - n) * t / nthreads);
+                hi = n + (int)((long)(s->capacity - n) * (t + 1) / nthreads);
+            }
+        }
+    }
+}
+
+// Recount the tiles from the grid after it was loaded or copied in; the
+// simulation keeps them up to date from then on
+void world_count_tiles(World *w) {
+    int tile_rows = (w->row_hi - w->row_lo + TILE - 1) / TILE;
+    #pragma omp parallel for schedule(static)
+    for (int tr = 0; tr < tile_rows; tr++) {
+        int *count = &w->tile_count[tr * w->tile_cols];
+        memset(count, 0, w->tile_cols * sizeof(int));
+        int x_end = w->row_lo + (tr + 1) * TILE < w->row_hi ? w->row_lo + (tr + 1) * TILE : w->row_hi;
+        for (int x = w->row_lo + tr * TILE; x < x_end; x++) {
+            const char *row = &w->ecosystem[CELL(w, x, 0)];
+            for (int y = 0; y < w->C; y++) {
+                count[y / TILE] += row[y] != '.';
+            }
+        }
+    }
+}
+
+// A cell of an owned row was filled (+1) or emptied (-1)
+static inline void tile_update(World *w, int x, int y, int delta) {
+    #pragma omp atomic
+    w->tile_count[TILE_OF(w, x, y)] += delta;
+}
+
+static inline bool owns_row(const World *w, int x) {
+    return x >= w->row_lo && x < w->row_hi;
+}
+
+// Objects seen in a slice of the input file, by kind. Rabbits, foxes and
+// rocks only count the ones in rows owned by the world being loaded.
+typedef struct {
+    int objects;
+    int rabbits;
+    int foxes;
+    int rocks;
+} ParseCounts;
+
+static inline const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+// Parse a non-negative decimal integer, returns NULL if there is none or
+// it does not fit in an int
+static inline const char *parse_int(const char *p, const char *end, int *value) {
+    p = skip_spaces(p, end);
+    if (p >= end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+    int v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        int digit = *p++ - '0';
+        if (v > (INT_MAX - digit) / 10) {
+            return NULL;
+        }
+        v = v * 10 + digit;
+    }
+    *value = v;
+    return p;
+}
+
+// Grid type of an object token, 0 if it is not ROCK, RABBIT or FOX
+static inline char object_kind(const char *type, long length) {
+    if (length == 4 && memcmp(type, "ROCK", 4) == 0) {
+        return 'X';
+    } else if (length == 6 && memcmp(type, "RABBIT", 6) == 0) {
+        return 'R';
+    } else if (length == 3 && memcmp(type, "FOX", 3) == 0) {
+        return 'F';
+    }
+    return 0;
+}
+
+// End of the line starting at p: its '\n' or end
+static inline const char *line_end(const char *p, const char *end) {
+    const char *eol = memchr(p, '\n', end - p);
+    return eol ? eol : end;
+}
+
+// Number of non-blank lines in [p, end)
+static int count_lines(const char *p, const char *end) {
+    int lines = 0;
+    while ((p = skip_spaces(p, end)) < end) {
+        lines++;
+        p = line_end(p, end);
+    }
+    return lines;
+}
+
+// First character of the line that contains or follows p
+static const char *line_start(const char *p, const char *begin, const char *end) {
+    while (p > begin && p < end && p[-1] != '\n') {
+        p++;
+    }
+    return p;
+}
+
+// Tokenize the "TYPE x y" lines in [p, end), one object per non-blank
+// line, whose id is base->objects plus its line number in the slice. Lines
+// past the header count are ignored. The first pass only counts; with fill
+// set, objects go straight into the grid and into the species slots
+// following base.
+static void parse_objects(World *w, const char *p, const char *end, int num_objects,
+                          bool fill, const ParseCounts *base, ParseCounts *count) {
+    memset(count, 0, sizeof(*count));
+    while ((p = skip_spaces(p, end)) < end) {
+        int i = base->objects + count->objects++;
+        if (i >= num_objects) {
+            break;
+        }
+        const char *eol = line_end(p, end);
+        const char *type = p;
+        while (p < eol && *p != ' ' && *p != '\t' && *p != '\r') {
+            p++;
+        }
+        char kind = object_kind(type, p - type);
+        int x, y;
+        if (!kind || !(p = parse_int(p, eol, &x)) || !(p = parse_int(p, eol, &y))) {
+            fprintf(stderr, "Error reading object %d\n", i);
+            exit(1);
+        }
+        p = eol;
+        if (x < 0 || x >= w->R || y < 0 || y >= w->C) {
+            fprintf(stderr, "Object %d at (%d, %d) is outside the world\n", i, x, y);
+            exit(1);
+        }
+        if (x < w->row_base || x >= w->row_base + w->rows) {
+            continue; // Stored by another part
+        }
+
+        int cell = CELL(w, x, y);
+        if (fill) {
+            w->ecosystem[cell] = kind;
+        }
+        if (x < w->row_lo || x >= w->row_hi) {
+            continue; // Ghost row: only the cell type matters
+        }
+
+        Species *s;
+        int k;
+        if (kind == 'F') {
+            s = &w->foxes;
+            k = base->foxes + count->foxes++;
+        } else if (kind == 'R') {
+            s = &w->rabbits;
+            k = base->rabbits + count->rabbits++;
+        } else {
+            count->rocks++;
+            continue;
+        }
+        if (fill) {
+            s->x[k] = x;
+            s->y[k] = y;
+            s->age[k] = 0;
+            s->hunger[k] = 0;
+            s->id[k] = i;
+            s->move_requested[k] = false;
+            s->dead[k] = false;
+            w->object_index[cell] = k;
+        }
+    }
+}
+
+// Read part `part` of `nparts` of the input: the owned rows with their
+// animals plus the contents of the ghost rows. The file is mapped into
+// memory and split at line boundaries into one slice per thread. Prefix
+// sums over the lines of every slice and then over the objects counted in
+// a first parse give every slice its ids and species slots, then the
+// slices are parsed again in parallel straight into the world.
+void read_input(World *w, const char* filename, int part, int nparts) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("Error opening input file");
+        exit(1);
+    }
+    size_t size = st.st_size;
+    const char *data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error mapping input file");
+        exit(1);
+    }
+    const char *end = data + size;
+
+    int header[7];
+    const char *p = data;
+    for (int k = 0; k < 7; k++) {
+        if (!(p = parse_int(p, end, &header[k]))) {
+            fprintf(stderr, "Error reading input header\n");
+            exit(1);
+        }
+    }
+    w->GEN_PROC_RABBITS = header[0];
+    w->GEN_PROC_FOXES = header[1];
+    w->GEN_FOOD_FOXES = header[2];
+    w->N_GEN = header[3];
+    w->R = header[4];
+    w->C = header[5];
+    int num_objects = header[6];
+    w->id_objetcs = num_objects;
+    w->colored = false;
+    world_layout(w, part, nparts);
+    world_alloc(w);
+
+    // Small files are not worth splitting
+    long body = end - p;
+    int nslices = omp_get_max_threads();
+    if (nslices > body / 65536 + 1) {
+        nslices = body / 65536 + 1;
+    }
+    const char **slice = xmalloc((nslices + 1) * sizeof(char *));
+    ParseCounts *counts = xmalloc((nslices + 1) * sizeof(ParseCounts));
+    for (int k = 0; k <= nslices; k++) {
+        slice[k] = line_start(p + body * k / nslices, p, end);
+    }
+
+    ParseCounts none = {0, 0, 0, 0};
+    counts[0] = none;
+    #pragma omp parallel for schedule(static, 1)
+    for (int k = 0; k < nslices; k++) {
+        counts[k + 1].objects = count_lines(slice[k], slice[k + 1]);
+    }
+    for (int k = 0; k < nslices; k++) {
+        counts[k + 1].objects += counts[k].objects;
+    }
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int k = 0; k < nslices; k++) {
+        ParseCounts first = {counts[k].objects, 0, 0, 0};
+        ParseCounts seen;
+        parse_objects(w, slice[k], slice[k + 1], num_objects, false, &first, &seen);
+        counts[k + 1].rabbits = seen.rabbits;
+        counts[k + 1].foxes = seen.foxes;
+        counts[k + 1].rocks = seen.rocks;
+    }
+    for (int k = 0; k < nslices; k++) {
+        counts[k + 1].rabbits += counts[k].rabbits;
+        counts[k + 1].foxes += counts[k].foxes;
+        counts[k + 1].rocks += counts[k].rocks;
+    }
+    if (counts[nslices].objects < num_objects) {
+        fprintf(stderr, "Error reading object %d\n", counts[nslices].objects);
+        exit(1);
+    }
+    world_first_touch(w, counts[nslices].rabbits, counts[nslices].foxes);
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int k = 0; k < nslices; k++) {
+        ParseCounts seen;
+        parse_objects(w, slice[k], slice[k + 1], num_objects, true, &counts[k], &seen);
+    }
+    w->rabbits.count = counts[nslices].rabbits;
+    w->foxes.count = counts[nslices].foxes;
+    w->num_rocks = counts[nslices].rocks;
+    world_count_tiles(w);
+
+    free(slice);
+    free(counts);
+    if (data) {
+        munmap((void *)data, size);
+    }
+}
+
+// Trace rendering. Every grid row becomes its own line(s) of output, so the
+// rows are formatted in parallel straight into a caller-provided buffer,
+// which is then written out with a single call.
+
+// Write v in decimal and return the end of the digits
+static inline char *put_int(char *p, int v) {
+    char digits[12];
+    int n = 0;
+    unsigned u = v < 0 ? -(unsigned)v : (unsigned)v;
+    do {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    if (v < 0) {
+        *p++ = '-';
+    }
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+// "Generation gen" header, preceded by a blank line after the first
+// generation as in the allgen* traces. Nothing for gen < 0.
+static size_t render_generation_header(char *buf, int gen) {
+    char *p = buf;
+    if (gen < 0) {
+        return 0;
+    }
+    if (gen > 0) {
+        *p++ = '\n';
+    }
+    memcpy(p, "Generation ", 11);
+    p = put_int(p + 11, gen);
+    *p++ = '\n';
+    return p - buf;
+}
+
+// Every line of print_ecosystem has three (C + 2)-wide matrices, four
+// separator characters and a newline
+static inline size_t ecosystem_line_length(const World *w) {
+    return 3 * (size_t)w->C + 11;
+}
+
+size_t ecosystem_render_size(const World *w) {
+    return 32 + (size_t)(w->R + 2) * ecosystem_line_length(w);
+}
+
+static void render_border(char *p, int C) {
+    memset(p, '-', C + 2);
+    p += C + 2;
+    memset(p, ' ', 3);
+    memset(p + 3, '-', C + 2);
+    p += C + 5;
+    *p = ' ';
+    memset(p + 1, '-', C + 2);
+    p[C + 3] = '\n';
+}
+
+// Render print_ecosystem's three matrices (types, ages, fox hunger) for
+// generation gen into buf and return the number of bytes written
+size_t render_ecosystem(World *w, int gen, char *buf) {
+    int C = w->C;
+    size_t line = ecosystem_line_length(w);
+    size_t head = render_generation_header(buf, gen);
+    char *grid = buf + head;
+
+    render_border(grid, C);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->R; i++) {
+        char *p = grid + (size_t)(i + 1) * line;
+        const char *types = &w->ecosystem[CELL(w, i, 0)];
+        const int *index = &w->object_index[CELL(w, i, 0)];
+        const int *tiles = &w->tile_count[TILE_OF(w, i, 0)];
+
+        // Object types with rocks shown as '*', ages as single digits and
+        // fox hunger or 'R' for rabbits, side by side
+        char *kinds = p + 1;
+        char *ages = kinds + C + 5;
+        char *hunger = ages + C + 3;
+        p[0] = '|';
+        memcpy(kinds + C, "|   |", 5);
+        memcpy(ages + C, "| |", 3);
+        hunger[C] = '|';
+        hunger[C + 1] = '\n';
+
+        for (int j0 = 0; j0 < C; j0 += TILE) {
+            int j1 = j0 + TILE < C ? j0 + TILE : C;
+            if (tiles[j0 / TILE] == 0) {
+                memset(kinds + j0, ' ', j1 - j0);
+                memset(ages + j0, ' ', j1 - j0);
+                memset(hunger + j0, ' ', j1 - j0);
+                continue;
+            }
+            for (int j = j0; j < j1; j++) {
+                char type = types[j];
+                kinds[j] = type == '.' ? ' ' : type == 'X' ? '*' : type;
+                ages[j] = type == 'R' ? '0' + w->rabbits.age[index[j]] % 10 :
+                          type == 'F' ? '0' + w->foxes.age[index[j]] % 10 :
+                          type == 'X' ? '*' : ' ';
+                hunger[j] = type == 'F' ? '0' + w->foxes.hunger[index[j]] % 10 :
+                            type == 'X' ? '*' : type == 'R' ? 'R' : ' ';
+            }
+        }
+    }
+    render_border(grid + (size_t)(w->R + 1) * line, C);
+
+    return head + (size_t)(w->R + 2) * line;
+}
+
+// Compact layout: a "+------+" separator line and a line of 7-character
+// cells per row, animals shown with their id. Ids past three digits widen
+// their cell, so rows have variable length.
+size_t ecosystem_compact_render_size(const World *w) {
+    return 64 + (size_t)w->R * (22 * (size_t)w->C + 3) + 8 * (size_t)w->C + 1;
+}
+
+static inline char *put_compact_cell(char *p, char type, int id) {
+    *p++ = '|';
+    if (type == 'R' || type == 'F') {
+        *p++ = ' ';
+        *p++ = type;
+        char *digits = p;
+        p = put_int(p, id);
+        while (p - digits < 3) {
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+    } else {
+        memcpy(p, type == 'X' ? " X    " : "      ", 6);
+        p += 6;
+    }
+    return p;
+}
+
+static char *put_separator(char *p, int C) {
+    for (int j = 0; j < C; j++) {
+        memcpy(p, "+------+", 8);
+        p += 8;
+    }
+    *p++ = '\n';
+    return p;
+}
+
+static inline int animal_id(World *w, int cell) {
+    char type = w->ecosystem[cell];
+    if (type == 'R') {
+        return w->rabbits.id[w->object_index[cell]];
+    }
+    return type == 'F' ? w->foxes.id[w->object_index[cell]] : 0;
+}
+
+// Rows are measured in parallel, a prefix sum over their lengths places
+// them, and a second parallel pass renders each row at its offset
+size_t render_ecosystem_compact(World *w, int gen, char *buf) {
+    int C = w->C;
+    size_t *offset = xmalloc((w->R + 1) * sizeof(size_t));
+    char *p = buf + render_generation_header(buf, gen);
+    memcpy(p, "----------------------\n", 23);
+    p += 23;
+
+    offset[0] = p - buf;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->R; i++) {
+        const int *tiles = &w->tile_count[TILE_OF(w, i, 0)];
+        size_t len = 8 * (size_t)C + 1 + 2 + 7 * (size_t)C;
+        for (int j = 0; j < C; j++) {
+            if (j % TILE == 0 && tiles[j / TILE] == 0) {
+                j += TILE - 1;
+                continue;
+            }
+            int cell = CELL(w, i, j);
+            if (w->ecosystem[cell] == 'R' || w->ecosystem[cell] == 'F') {
+                char digits[12];
+                int n = put_int(digits, animal_id(w, cell)) - digits;
+                len += (n > 3 ? n : 3) - 3;
+            }
+        }
+        offset[i + 1] = len;
+    }
+    for (int i = 0; i < w->R; i++) {
+        offset[i + 1] += offset[i];
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->R; i++) {
+        const int *tiles = &w->tile_count[TILE_OF(w, i, 0)];
+        char *q = put_separator(buf + offset[i], C);
+        for (int j = 0; j < C; j++) {
+            if (j % TILE == 0 && tiles[j / TILE] == 0) {
+                for (int k = j; k < j + TILE && k < C; k++) {
+                    q = put_compact_cell(q, '.', 0);
+                }
+                j += TILE - 1;
+                continue;
+            }
+            int cell = CELL(w, i, j);
+            q = put_compact_cell(q, w->ecosystem[cell], animal_id(w, cell));
+        }
+        q[0] = '|';
+        q[1] = '\n';
+    }
+
+    p = put_separator(buf + offset[w->R], C) - 1;
+    memcpy(p, "\n----------------------\n", 24);
+    p += 24;
+    free(offset);
+    return p - buf;
+}
+
+void print_ecosystem_compact(World *w) {
+    char *buf = xmalloc(ecosystem_compact_render_size(w));
+    fwrite(buf, 1, render_ecosystem_compact(w, -1, buf), stdout);
+    free(buf);
+}
+
+void print_ecosystem(World *w) {
+    char *buf = xmalloc(ecosystem_render_size(w));
+    fwrite(buf, 1, render_ecosystem(w, -1, buf), stdout);
+    free(buf);
+}
+
+void print_object(World *w, const Species *s, int i) {
+    printf("\nObject Details:\n");
+    printf("Type: %c\n", s == &w->rabbits ? 'R' : 'F');
+    printf("ID: %d\n", s->id[i]);
+    printf("Position: (%d, %d)\n", s->x[i], s->y[i]);
+    printf("Age: %d\n", s->age[i]);
+    printf("Hunger: %d\n", s->hunger[i]);
+    printf("Intended Move: New Position (%d, %d), Move Requested: %s\n",
+           s->new_x[i], s->new_y[i], s->move_requested[i] ? "Yes" : "No");
+}
+
+// Final-state lines are assembled from fixed-size copies of prepared
+// text: the kind, the row number once per row and the column number from
+// a table built once per width, so no number is converted per object.
+// Entry y of the column table is the length of "y\n" followed by it.
+#define COLUMN_TEXT 16
+// Longest final-state line, "RABBIT <int> <int>\n"
+#define FINAL_LINE_MAX 31
+
+char *column_text(int C) {
+    char *columns = xmalloc((size_t)C * COLUMN_TEXT);
+    for (int y = 0; y < C; y++) {
+        char *text = &columns[(size_t)y * COLUMN_TEXT];
+        char *end = put_int(text + 1, y);
+        *end++ = '\n';
+        text[0] = end - (text + 1);
+    }
+    return columns;
+}
+
+// Bytes needed to render lines final-state lines, copies overshooting the
+// last line included
+static inline size_t final_lines_size(size_t lines) {
+    return lines * FINAL_LINE_MAX + COLUMN_TEXT;
+}
+
+// Render the objects of row x, C cells, and return the end of the text.
+// With the tile counts of the row's band of tiles, empty tiles are skipped.
+static char *render_final_row(char *p, const char *cells, int x, int C, const int *tiles, const char *columns) {
+    static const char kinds[3][8] = {"ROCK ", "RABBIT ", "FOX "};
+    static const int kind_length[3] = {5, 7, 4};
+    char row[16];
+    char *row_end = put_int(row, x);
+    *row_end++ = ' ';
+    int row_length = row_end - row;
+    for (int y = 0; y < C; y++) {
+        if (tiles && y % TILE == 0 && tiles[y / TILE] == 0) {
+            y += TILE - 1;
+            continue;
+        }
+        char type = cells[y];
+        if (type == '.') {
+            continue;
+        }
+        int k = type == 'X' ? 0 : type == 'R' ? 1 : 2;
+        const char *column = &columns[(size_t)y * COLUMN_TEXT];
+        memcpy(p, kinds[k], 8);
+        p += kind_length[k];
+        memcpy(p, row, 16);
+        p += row_length;
+        memcpy(p, column + 1, COLUMN_TEXT - 1);
+        p += column[0];
+    }
+    return p;
+}
+
+// Print the objects of nrows consecutive grid rows, the first being row x0,
+// through a buffer written out whenever it may not hold another row.
+// With the tile counts of those rows, empty tiles are skipped.
+void print_final_rows(FILE *file, const char *cells, int x0, int nrows, int C, const int *tile_count) {
+    int tile_cols = (C + TILE - 1) / TILE;
+    char *columns = column_text(C);
+    size_t row_size = final_lines_size(C);
+    size_t capacity = row_size > (1 << 20) ? row_size : 1 << 20;
+    char *buf = xmalloc(capacity);
+    char *p = buf;
+    for (int i = 0; i < nrows; i++) {
+        if ((size_t)(buf + capacity - p) < row_size) {
+            fwrite(buf, 1, p - buf, file);
+            p = buf;
+        }
+        p = render_final_row(p, &cells[(size_t)i * C], x0 + i, C,
+                             tile_count ? &tile_count[i / TILE * tile_cols] : NULL, columns);
+    }
+    fwrite(buf, 1, p - buf, file);
+    free(buf);
+    free(columns);
+}
+
+void print_final_state(World *w, FILE *file) {
+    int num_objects = w->num_rocks + w->rabbits.count + w->foxes.count;
+    fprintf(file, "%d %d %d %d %d %d %d\n", w->GEN_PROC_RABBITS, w->GEN_PROC_FOXES, w->GEN_FOOD_FOXES, 0,
+            w->R, w->C, num_objects);
+    print_final_rows(file, &w->ecosystem[CELL(w, w->row_lo, 0)], w->row_lo, w->row_hi - w->row_lo, w->C,
+                     w->tile_count);
+}
+
+// Phase profiling: every parallel phase times the work each thread does in
+// it, leaving out the wait at the closing barrier, and the calling thread
+// times the phase as a whole. Comparing the slowest thread with the average
+// one shows how much of a phase is lost to load imbalance.
+
+static const char *phase_names[NUM_PHASES] = {"collect", "resolve", "apply", "cleanup"};
+
+void profile_init(Profiler *p, bool tracing) {
+    p->nthreads = omp_get_max_threads();
+    p->tracing = tracing;
+    p->origin = omp_get_wtime();
+    memset(p->wall, 0, sizeof(p->wall));
+    p->threads = xmalloc(p->nthreads * sizeof(ProfileThread));
+    memset(p->threads, 0, p->nthreads * sizeof(ProfileThread));
+}
+
+void profile_free(Profiler *p) {
+    for (int t = 0; t < p->nthreads; t++) {
+        free(p->threads[t].events);
+    }
+    free(p->threads);
+}
+
+// Start of a timed stretch; free when profiling is off
+static inline double profile_now(const World *w) {
+    return w->profile ? omp_get_wtime() : 0.0;
+}
+
+// Charge the time since start to the calling thread
+void profile_thread(World *w, int phase, double start) {
+    Profiler *p = w->profile;
+    if (!p) {
+        return;
+    }
+    double end = omp_get_wtime();
+    int t = omp_get_thread_num();
+    if (t >= p->nthreads) {
+        return;
+    }
+    ProfileThread *pt = &p->threads[t];
+    pt->busy[phase] += end - start;
+    if (p->tracing) {
+        if (pt->event_count == pt->event_capacity) {
+            pt->event_capacity = pt->event_capacity ? 2 * pt->event_capacity : 1024;
+            pt->events = realloc(pt->events, pt->event_capacity * sizeof(TraceEvent));
+            if (!pt->events) {
+                perror("Memory allocation failed");
+                exit(1);
+            }
+        }
+        pt->events[pt->event_count++] = (TraceEvent){phase, start - p->origin, end - p->origin};
+    }
+}
+
+// Charge the time since start to the phase as a whole
+void profile_phase(World *w, int phase, double start) {
+    if (w->profile) {
+        w->profile->wall[phase] += omp_get_wtime() - start;
+    }
+}
+
+// Breakdown of the phases summed over all generations. Imbalance is the
+// busiest thread over the average thread; 1.00 is a perfect balance.
+void profile_report(const Profiler *p, FILE *file) {
+    double total = 0;
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        total += p->wall[phase];
+    }
+    fprintf(file, "%-8s %12s %7s %12s %12s %12s %9s\n",
+            "phase", "wall (s)", "share", "mean (s)", "min (s)", "max (s)", "imbalance");
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        double sum = 0, min = 0, max = 0;
+        for (int t = 0; t < p->nthreads; t++) {
+            double busy = p->threads[t].busy[phase];
+            sum += busy;
+            min = t == 0 || busy < min ? busy : min;
+            max = busy > max ? busy : max;
+        }
+        double mean = sum / p->nthreads;
+        fprintf(file, "%-8s %12.6f %6.1f%% %12.6f %12.6f %12.6f %9.2f\n", phase_names[phase],
+                p->wall[phase], total > 0 ? 100 * p->wall[phase] / total : 0.0,
+                mean, min, max, mean > 0 ? max / mean : 1.0);
+    }
+    fprintf(file, "%-8s %12.6f (%d threads)\n", "total", total, p->nthreads);
+}
+
+// Timeline in the Chrome trace event format (chrome://tracing, Perfetto):
+// one complete event per stretch of work, one row per thread
+void profile_write_trace(const Profiler *p, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror("Error opening profile trace file");
+        exit(1);
+    }
+    fprintf(file, "{\"traceEvents\":[");
+    bool first = true;
+    for (int t = 0; t < p->nthreads; t++) {
+        const ProfileThread *pt = &p->threads[t];
+        for (int k = 0; k < pt->event_count; k++) {
+            const TraceEvent *e = &pt->events[k];
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",", phase_names[e->phase], t, e->start * 1e6, (e->end - e->start) * 1e6);
+            first = false;
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+}
+
+// Remove dead entries from a species with a parallel stream compaction:
+// each thread counts the survivors in its static block, an exclusive prefix
+// sum over those counts gives every block its output offset, and the blocks
+// are scattered into the spare arrays, which are then swapped in. Survivors
+// keep their relative order and object_index is pointed at the new slots.
+// Grid cells of dead animals have already been cleared (or taken over) by
+// the apply phase.
+void cleanup_dead_objects(World *w, Species *s) {
+    Species *dst = &w->spare;
+    int n = s->count;
+    dst->count = 0;
+    species_reserve(dst, n);
+    int *offsets = w->thread_offsets;
+    IdentityTable *identity = w->identity;
+    int active_objects = 0;
+    long age_sum = 0;
+    double phase_start = profile_now(w);
+
+    #pragma omp parallel reduction(+:age_sum)
+    {
+        double start = profile_now(w);
+        int t = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int lo = (int)((long)n * t / nthreads);
+        int hi = (int)((long)n * (t + 1) / nthreads);
+
+        // Survivors also clear the claims, which only remain on the cells
+        // that the winners of the last conflicts moved into
+        int alive = 0;
+        for (int i = lo; i < hi; i++) {
+            if (!s->dead[i]) {
+                alive++;
+                age_sum += s->age[i];
+                w->claims[CELL(w, s->x[i], s->y[i])] = -1;
+            } else if (identity) {
+                identity_release(identity, s->slot[i]);
+            }
+        }
+        offsets[t + 1] = alive;
+        profile_thread(w, PHASE_CLEANUP, start);
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            offsets[0] = 0;
+            for (int k = 0; k < nthreads; k++) {
+                offsets[k + 1] += offsets[k];
+            }
+            active_objects = offsets[nthreads];
+        }
+
+        // Nothing died: leave the arrays untouched
+        if (active_objects != n) {
+            start = profile_now(w);
+            int k = offsets[t];
+            for (int i = lo; i < hi; i++) {
+                if (s->dead[i]) {
+                    continue;
+                }
+                dst->x[k] = s->x[i];
+                dst->y[k] = s->y[i];
+                dst->age[k] = s->age[i];
+                dst->hunger[k] = s->hunger[i];
+                dst->id[k] = s->id[i];
+                dst->move_requested[k] = false;
+                dst->dead[k] = false;
+                w->object_index[CELL(w, s->x[i], s->y[i])] = k;
+                if (identity) {
+                    dst->slot[k] = s->slot[i];
+                    identity->index[s->slot[i]] = k;
+                }
+                k++;
+            }
+            profile_thread(w, PHASE_CLEANUP, start);
+        }
+    }
+
+    if (active_objects != n) {
+        Species tmp = *s;
+        *s = *dst;
+        *dst = tmp;
+    }
+    s->count = active_objects;
+    s->age_sum = age_sum;
+    profile_phase(w, PHASE_CLEANUP, phase_start);
+}
+
+// Age an animal will have after this generation if it moves
+static inline int age_after_move(const Species *s, int i, int gen_proc) {
+    return s->age[i] >= gen_proc ? 0 : s->age[i] + 1;
+}
+
+// True if mover i beats mover j for the cell they both target. Animals
+// are compared by the age they will have after moving, foxes then by
+// lower hunger, and remaining ties go to the lower index, so the winner
+// does not depend on the order in which claims are made. Only i's target
+// is read: j may still be writing its own.
+static inline bool wins_conflict(World *w, const Species *s, int i, int j, int C, int gen_proc) {
+    int age_i = age_after_move(s, i, gen_proc);
+    int age_j = age_after_move(s, j, gen_proc);
+    if (age_i != age_j) {
+        return age_i > age_j;
+    }
+    // Foxes on the same target either both eat or both go hungry
+    if (s == &w->foxes && s->hunger[i] != s->hunger[j] &&
+        w->ecosystem[CELL_C(w, C, s->new_x[i], s->new_y[i])] != 'R') {
+        return s->hunger[i] < s->hunger[j];
+    }
+    return i < j;
+}
+
+static inline int species_gen_proc(const World *w, const Species *s) {
+    return s == &w->rabbits ? w->GEN_PROC_RABBITS : w->GEN_PROC_FOXES;
+}
+
+// Make mover i the claimant of its target if it beats the current one.
+// Losers keep move_requested, since they still leave their offspring
+// behind; apply_moves_* tells them apart by the claims.
+static inline void claim_cell(World *w, const Species *s, int i) {
+    int cell = CELL(w, s->new_x[i], s->new_y[i]);
+    int best = w->claims[cell];
+    if (best == -1 || wins_conflict(w, s, i, best, w->C, species_gen_proc(w, s))) {
+        w->claims[cell] = i;
+    }
+}
+
+// Lock-free claim_cell for movers claiming concurrently: retry until i is
+// in place or the claimant found there beats it
+static inline void claim_cell_atomic(World *w, const Species *s, int i, int C, int gen_proc) {
+    int *claim = &w->claims[CELL_C(w, C, s->new_x[i], s->new_y[i])];
+    int best = __atomic_load_n(claim, __ATOMIC_RELAXED);
+    while ((best == -1 || wins_conflict(w, s, i, best, C, gen_proc)) &&
+           !__atomic_compare_exchange_n(claim, &best, i, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Directions j whose neighbour of a cell holds type, as a mask with bit j
+// set for direction j. Edge cells read into the stored ghost rows or the
+// next row, which stay in bounds; the border mask drops those neighbours.
+static inline unsigned neighbour_mask(const char *cell, int C, unsigned border, char type) {
+    unsigned mask = (cell[-C] == type) | (cell[1] == type) << 1 | (cell[C] == type) << 2 | (cell[-1] == type) << 3;
+    return mask & border;
+}
+
+static inline unsigned border_mask(int R, int C, int x, int y) {
+    return (x > 0) | (y < C - 1) << 1 | (x < R - 1) << 2 | (y > 0) << 3;
+}
+
+// direction_pick[mask][n % 12] is the direction of the (n % count)-th set
+// bit of mask, count being its popcount. 12 is a multiple of every count,
+// so this turns the modulo by a count known only at run time into one by
+// a constant, and drops the bit search.
+static const unsigned char direction_pick[16][12] = {
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1},
+    {2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2},
+    {1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2},
+    {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2},
+    {3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3},
+    {0, 3, 0, 3, 0, 3, 0, 3, 0, 3, 0, 3},
+    {1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3},
+    {0, 1, 3, 0, 1, 3, 0, 1, 3, 0, 1, 3},
+    {2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3},
+    {0, 2, 3, 0, 2, 3, 0, 2, 3, 0, 2, 3},
+    {1, 2, 3, 1, 2, 3, 1, 2, 3, 1, 2, 3},
+    {0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3},
+};
+
+// Movers pick among their valid neighbours, in N, E, S, W order, the one
+// at (gen + x + y) % count
+static inline int pick_direction(unsigned mask, int gen, int x, int y) {
+    return direction_pick[mask][(unsigned)(gen + x + y) % 12];
+}
+
+// Parameter sets and grid widths, as (GEN_PROC_RABBITS, GEN_PROC_FOXES,
+// GEN_FOOD_FOXES, C), that get kernels of their own when built with
+// -DSPECIALIZED_KERNELS: those of the shipped inputs. Each copy has the
+// constants folded into its rules and cell arithmetic; any other world
+// runs the generic kernels, which read them from the World.
+#ifdef SPECIALIZED_KERNELS
+#define SPECIALIZED_WORLDS(X) \
+    X(2, 4, 3, 5)             \
+    X(2, 9, 6, 10)            \
+    X(3, 9, 6, 20)            \
+    X(3, 9, 6, 100)           \
+    X(3, 20, 10, 100)         \
+    X(3, 20, 10, 200)
+#else
+#define SPECIALIZED_WORLDS(X)
+#endif
+
+#define KERNEL_SET_NAME(pr, pf, ff, c) KERNELS_##pr##_##pf##_##ff##_##c,
+enum { SPECIALIZED_WORLDS(KERNEL_SET_NAME) GENERIC_KERNELS };
+
+#define KERNEL_SET_MATCH(pr, pf, ff, c)                                                                      \
+    if (w->GEN_PROC_RABBITS == (pr) && w->GEN_PROC_FOXES == (pf) && w->GEN_FOOD_FOXES == (ff) && w->C == (c)) { \
+        return KERNELS_##pr##_##pf##_##ff##_##c;                                                             \
+    }
+
+static int kernel_set(const World *w) {
+    (void)w; // Unused without specialized kernels
+    SPECIALIZED_WORLDS(KERNEL_SET_MATCH)
+    return GENERIC_KERNELS;
+}
+
+// Call kernel(C, GEN_PROC_RABBITS, GEN_PROC_FOXES, GEN_FOOD_FOXES) with
+// the constants of kernel set `set`, or with the values of w. Used inside
+// the parallel regions, so every specialized copy ends up in the function
+// the compiler outlines for the region.
+#define KERNEL_SET_CASE(pr, pf, ff, c)      \
+    case KERNELS_##pr##_##pf##_##ff##_##c: \
+        KERNEL(c, pr, pf, ff);             \
+        break;
+
+#define DISPATCH_KERNEL(set, w)                                                                  \
+    switch (set) {                                                                               \
+        SPECIALIZED_WORLDS(KERNEL_SET_CASE)                                                      \
+    default:                                                                                     \
+        KERNEL((w)->C, (w)->GEN_PROC_RABBITS, (w)->GEN_PROC_FOXES, (w)->GEN_FOOD_FOXES);        \
+    }
+
+// Static block [lo, hi) of n items for the calling thread
+static inline void thread_block(int n, int *lo, int *hi) {
+    int t = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    *lo = (int)((long)n * t / nthreads);
+    *hi = (int)((long)n * (t + 1) / nthreads);
+}
+
+static inline __attribute__((always_inline)) void collect_rabbits_range(World *w, int gen, bool claim, int lo,
+                                                                        int hi, int C, int gen_proc) {
+    Species *s = &w->rabbits;
+    for (int i = lo; i < hi; i++) {
+        int x = s->x[i];
+        int y = s->y[i];
+        unsigned free_cells = neighbour_mask(&w->ecosystem[CELL_C(w, C, x, y)], C, border_mask(w->R, C, x, y), '.');
+        if (free_cells) {
+            int d = pick_direction(free_cells, gen, x, y);
+            s->new_x[i] = x + STEP_X(d);
+            s->new_y[i] = y + STEP_Y(d);
+            s->move_requested[i] = true;
+            if (claim) {
+                claim_cell_atomic(w, s, i, C, gen_proc);
+            }
+        }
+    }
+}
+
+// With claim set, movers also claim their target right away, which fuses
+// conflict resolution into this pass
+void collect_moves_rabbits(World *w, int gen, bool claim) {
+    int set = kernel_set(w);
+    int n = w->rabbits.count;
+    double phase_start = profile_now(w);
+
+    #pragma omp parallel
+    {
+        double start = profile_now(w);
+        int lo, hi;
+        thread_block(n, &lo, &hi);
+#define KERNEL(c, pr, pf, ff) collect_rabbits_range(w, gen, claim, lo, hi, c, pr)
+        DISPATCH_KERNEL(set, w)
+#undef KERNEL
+        profile_thread(w, PHASE_COLLECT, start);
+    }
+    profile_phase(w, PHASE_COLLECT, phase_start);
+}
+
+static inline __attribute__((always_inline)) void collect_foxes_range(World *w, int gen, bool claim, int lo,
+                                                                      int hi, int C, int gen_proc, int gen_food) {
+    Species *s = &w->foxes;
+    for (int i = lo; i < hi; i++) {
+        int x = s->x[i];
+        int y = s->y[i];
+        const char *cell = &w->ecosystem[CELL_C(w, C, x, y)];
+        unsigned border = border_mask(w->R, C, x, y);
+        unsigned prey = neighbour_mask(cell, C, border, 'R');
+
+        unsigned options;
+        if (prey) {
+            options = prey; // Rabbits first
+        } else if (s->hunger[i] + 1 >= gen_food) {
+            s->dead[i] = true; // Starves before it gets to move
+            continue;
+        } else {
+            options = neighbour_mask(cell, C, border, '.');
+            if (!options) {
+                continue;
+            }
+        }
+        int d = pick_direction(options, gen, x, y);
+        s->new_x[i] = x + STEP_X(d);
+        s->new_y[i] = y + STEP_Y(d);
+        s->move_requested[i] = true;
+        if (claim) {
+            claim_cell_atomic(w, s, i, C, gen_proc);
+        }
+    }
+}
+
+void collect_moves_foxes(World *w, int gen, bool claim) {
+    int set = kernel_set(w);
+    int n = w->foxes.count;
+    double phase_start = profile_now(w);
+
+    #pragma omp parallel
+    {
+        double start = profile_now(w);
+        int lo, hi;
+        thread_block(n, &lo, &hi);
+#define KERNEL(c, pr, pf, ff) collect_foxes_range(w, gen, claim, lo, hi, c, pf, ff)
+        DISPATCH_KERNEL(set, w)
+#undef KERNEL
+        profile_thread(w, PHASE_COLLECT, start);
+    }
+    profile_phase(w, PHASE_COLLECT, phase_start);
+}
+
+// Colored variant of resolve_conflicts. Cell (x, y) gets color (x + 2y) % 5,
+// which gives the four neighbours of any cell four different colors, so
+// movers starting on cells of one color never target the same cell. Each
+// color class is claimed fully in parallel without locks.
+void resolve_conflicts_colored(World *w, Species *s) {
+    #pragma omp parallel
+    {
+        for (int c = 0; c < 5; c++) {
+            double start = profile_now(w);
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < s->count; i++) {
+                if ((s->x[i] + 2 * s->y[i]) % 5 == c && s->move_requested[i] && !s->dead[i]) {
+                    claim_cell(w, s, i);
+                }
+            }
+            profile_thread(w, PHASE_RESOLVE, start);
+            #pragma omp barrier
+        }
+    }
+}
+
+// Keep a single claimant per target cell. The claims stay in place for
+// apply_moves_* and are cleared by the compaction that follows it.
+void resolve_conflicts(World *w, Species *s) {
+    double phase_start = profile_now(w);
+    if (w->colored) {
+        resolve_conflicts_colored(w, s);
+        profile_phase(w, PHASE_RESOLVE, phase_start);
+        return;
+    }
+
+    for (int i = 0; i < s->count; i++) {
+        if (s->move_requested[i] && !s->dead[i]) {
+            claim_cell(w, s, i);
+        }
+    }
+    // Serial: the calling thread does all the work
+    profile_thread(w, PHASE_RESOLVE, phase_start);
+    profile_phase(w, PHASE_RESOLVE, phase_start);
+}
+
+// Births are recorded by every thread in its block of birth_cells, the
+// block of the parents it applies, and placed once all threads are done:
+// a prefix sum over the per-thread counts lays the newborns out in parent
+// order, so they get the same index and id at any thread count and no
+// thread waits on another to hand them out. Called by every thread of the
+// apply region, with the species count n from before the phase. Only the
+// placement itself is charged to the apply phase, not the barriers.
+static void place_births(World *w, Species *s, int n, int lo, int count) {
+    int t = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    int *offsets = w->thread_offsets;
+    offsets[t + 1] = count;
+    #pragma omp barrier
+    #pragma omp single
+    {
+        offsets[0] = 0;
+        for (int k = 0; k < nthreads; k++) {
+            offsets[k + 1] += offsets[k];
+        }
+        species_reserve(s, n + offsets[nthreads]);
+        if (w->identity) {
+            identity_grow(w->identity, offsets[nthreads]);
+            identity_reserve(w->identity, w->id_objetcs + offsets[nthreads] * w->id_stride + 1);
+        }
+    }
+
+    double start = profile_now(w);
+    int first = offsets[t];
+    char kind = s == &w->rabbits ? 'R' : 'F';
+    for (int k = 0; k < count; k++) {
+        int cell = w->birth_cells[lo + k];
+        int child = n + first + k;
+        s->x[child] = cell / w->C + w->row_base;
+        s->y[child] = cell % w->C;
+        s->age[child] = 0;
+        s->hunger[child] = 0;
+        s->id[child] = w->id_objetcs + (first + k + 1) * w->id_stride;
+        s->move_requested[child] = false;
+        s->dead[child] = false;
+        w->object_index[cell] = child;
+        if (w->identity) {
+            s->slot[child] = identity_take(w->identity, first + k, kind, child, s->id[child]);
+        }
+    }
+    profile_thread(w, PHASE_APPLY, start);
+
+    #pragma omp barrier
+    #pragma omp single
+    {
+        int total = offsets[nthreads];
+        s->count = n + total;
+        w->id_objetcs += total * w->id_stride;
+        if (w->identity) {
+            w->identity->free_count -= total;
+        }
+    }
+}
+
+// Move animal i out of its cell, leaving offspring behind when it is old
+// enough; returns 1 for a birth, whose cell goes to *birth_cell. Conflict
+// losers and animals emigrating to a neighbouring strip go through here
+// too; they just never arrive.
+static inline int leave_cell(World *w, Species *s, int i, int C, int gen_proc, int *birth_cell) {
+    if (!owns_row(w, s->x[i])) {
+        // Immigrant: the sending strip already handled its old cell
+        s->age[i] = age_after_move(s, i, gen_proc);
+        return 0;
+    }
+    int old_cell = CELL_C(w, C, s->x[i], s->y[i]);
+    if (s->age[i] >= gen_proc) {
+        s->age[i] = 0;
+        *birth_cell = old_cell; // Stays occupied, place_births fills it in
+        return 1;
+    }
+    s->age[i]++;
+    w->ecosystem[old_cell] = '.';
+    w->object_index[old_cell] = -1;
+    return 0;
+}
+
+// Tile counts for mover i, still at its old cell: that cell was vacated
+// unless it left offspring or came from another strip, and the new cell
+// filled up unless it was taken already or never reached. Most moves stay
+// inside their tile and need no update at all.
+static inline void tile_move(World *w, const Species *s, int i, bool vacated, bool filled) {
+    if (vacated && filled && TILE_OF(w, s->x[i], s->y[i]) == TILE_OF(w, s->new_x[i], s->new_y[i])) {
+        return;
+    }
+    if (vacated) {
+        tile_update(w, s->x[i], s->y[i], -1);
+    }
+    if (filled) {
+        tile_update(w, s->new_x[i], s->new_y[i], +1);
+    }
+}
+
+static inline __attribute__((always_inline)) void apply_rabbits_range(World *w, int lo, int hi, int C,
+                                                                      int gen_proc, GenerationStats *st) {
+    Species *s = &w->rabbits;
+    for (int i = lo; i < hi; i++) {
+        if (!s->move_requested[i]) {
+            s->age[i]++;
+            continue;
+        }
+
+        // Emigrants are already dead; conflict losers are not the claimant
+        int new_cell = CELL_C(w, C, s->new_x[i], s->new_y[i]);
+        s->dead[i] |= w->claims[new_cell] != i;
+        int born = leave_cell(w, s, i, C, gen_proc, &w->birth_cells[lo + st->rabbit_births]);
+        bool vacated = !born && owns_row(w, s->x[i]);
+        st->rabbit_births += born;
+        s->move_requested[i] = false;
+        if (s->dead[i]) {
+            tile_move(w, s, i, vacated, false);
+            st->rabbit_conflict_deaths++; // Lost a conflict
+            continue;
+        }
+
+        tile_move(w, s, i, vacated, true);
+        w->ecosystem[new_cell] = 'R';
+        w->object_index[new_cell] = i;
+        s->x[i] = s->new_x[i];
+        s->y[i] = s->new_y[i];
+    }
+}
+
+void apply_moves_rabbits(World *w) {
+    Species *s = &w->rabbits;
+    int set = kernel_set(w);
+    int n = s->count;
+    world_reserve_births(w, n);
+    int births = 0, conflict_deaths = 0;
+    double phase_start = profile_now(w);
+
+    #pragma omp parallel reduction(+:births, conflict_deaths)
+    {
+        double start = profile_now(w);
+        GenerationStats st = {0};
+        int lo, hi;
+        thread_block(n, &lo, &hi);
+#define KERNEL(c, pr, pf, ff) apply_rabbits_range(w, lo, hi, c, pr, &st)
+        DISPATCH_KERNEL(set, w)
+#undef KERNEL
+        profile_thread(w, PHASE_APPLY, start);
+        place_births(w, s, n, lo, st.rabbit_births);
+        births += st.rabbit_births;
+        conflict_deaths += st.rabbit_conflict_deaths;
+    }
+
+    w->stats.rabbit_births = births;
+    w->stats.rabbit_conflict_deaths = conflict_deaths;
+    profile_phase(w, PHASE_APPLY, phase_start);
+    cleanup_dead_objects(w, s);
+}
+
+static inline __attribute__((always_inline)) void apply_foxes_range(World *w, int lo, int hi, int C, int gen_proc,
+                                                                    GenerationStats *st) {
+    Species *s = &w->foxes;
+    Species *rabbits = &w->rabbits;
+    for (int i = lo; i < hi; i++) {
+        if (!s->move_requested[i]) {
+            if (s->dead[i]) {
+                // Starved: vacate the cell
+                int old_cell = CELL_C(w, C, s->x[i], s->y[i]);
+                w->ecosystem[old_cell] = '.';
+                w->object_index[old_cell] = -1;
+                tile_update(w, s->x[i], s->y[i], -1);
+                st->foxes_starved++;
+            } else {
+                s->hunger[i]++;
+                s->age[i]++;
+            }
+            continue;
+        }
+
+        int new_cell = CELL_C(w, C, s->new_x[i], s->new_y[i]);
+        s->dead[i] |= w->claims[new_cell] != i;
+        int born = leave_cell(w, s, i, C, gen_proc, &w->birth_cells[lo + st->fox_births]);
+        bool vacated = !born && owns_row(w, s->x[i]);
+        st->fox_births += born;
+        s->move_requested[i] = false;
+        if (s->dead[i]) {
+            tile_move(w, s, i, vacated, false);
+            st->fox_conflict_deaths++; // Lost a conflict
+            continue;
+        }
+
+        if (w->ecosystem[new_cell] == 'R') {
+            // Fox eats a rabbit; only the conflict winner reaches this cell
+            rabbits->dead[w->object_index[new_cell]] = true;
+            s->hunger[i] = 0;
+            st->rabbits_eaten++;
+            tile_move(w, s, i, vacated, false);
+        } else {
+            s->hunger[i]++;
+            tile_move(w, s, i, vacated, true);
+        }
+        w->ecosystem[new_cell] = 'F';
+        w->object_index[new_cell] = i;
+        s->x[i] = s->new_x[i];
+        s->y[i] = s->new_y[i];
+    }
+}
+
+void apply_moves_foxes(World *w) {
+    Species *s = &w->foxes;
+    int set = kernel_set(w);
+    int n = s->count;
+    world_reserve_births(w, n);
+    int births = 0, conflict_deaths = 0, starved = 0, eaten = 0;
+    double phase_start = profile_now(w);
+
+    #pragma omp parallel reduction(+:births, conflict_deaths, starved, eaten)
+    {
+        double start = profile_now(w);
+        GenerationStats st = {0};
+        int lo, hi;
+        thread_block(n, &lo, &hi);
+#define KERNEL(c, pr, pf, ff) apply_foxes_range(w, lo, hi, c, pf, &st)
+        DISPATCH_KERNEL(set, w)
+#undef KERNEL
+        profile_thread(w, PHASE_APPLY, start);
+        place_births(w, s, n, lo, st.fox_births);
+        births += st.fox_births;
+        conflict_deaths += st.fox_conflict_deaths;
+        starved += st.foxes_starved;
+        eaten += st.rabbits_eaten;
+    }
+
+    w->stats.fox_births = births;
+    w->stats.fox_conflict_deaths = conflict_deaths;
+    w->stats.foxes_starved = starved;
+    w->stats.rabbits_eaten = eaten;
+    profile_phase(w, PHASE_APPLY, phase_start);
+    cleanup_dead_objects(w, &w->rabbits);
+    cleanup_dead_objects(w, s);
+}
+
+// One CSV line per generation with the population and the events that
+// led to it, for monitoring runs that do not need the grids
+void print_stats_header(FILE *file) {
+    fprintf(file, "generation,rabbits,foxes,rabbit_births,fox_births,rabbits_eaten,foxes_starved,"
+                  "rabbit_conflict_deaths,fox_conflict_deaths,mean_rabbit_age,mean_fox_age\n");
+}
+
+void print_stats(FILE *file, World *w, int gen) {
+    const GenerationStats *st = &w->stats;
+    fprintf(file, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f\n", gen, w->rabbits.count, w->foxes.count,
+            st->rabbit_births, st->fox_births, st->rabbits_eaten, st->foxes_starved,
+            st->rabbit_conflict_deaths, st->fox_conflict_deaths,
+            w->rabbits.count ? (double)w->rabbits.age_sum / w->rabbits.count : 0.0,
+            w->foxes.count ? (double)w->foxes.age_sum / w->foxes.count : 0.0);
+}
+
+// An animal followed from generation to generation by its handle. Ids not
+// handed out yet belong to animals still to be born; they are looked up
+// again every generation until the animal appears.
+typedef struct {
+    int id;
+    AnimalHandle handle;
+    bool born;
+    bool alive;
+} Follow;
+
+// Check the ids to follow against the identity table, which must be
+// attached: ids already handed out must belong to living animals
+void follow_start(World *w, Follow *follow, int count) {
+    for (int f = 0; f < count; f++) {
+        follow[f].born = identity_find(w->identity, follow[f].id, &follow[f].handle);
+        follow[f].alive = follow[f].born;
+        if (!follow[f].born && follow[f].id < w->id_objetcs) {
+            fprintf(stderr, "No animal with id %d to follow\n", follow[f].id);
+            exit(1);
+        }
+    }
+}
+
+// One line per followed animal, and a last one when it is gone
+void follow_report(FILE *file, World *w, Follow *follow, int count, int gen) {
+    for (int f = 0; f < count; f++) {
+        if (!follow[f].born && identity_find(w->identity, follow[f].id, &follow[f].handle)) {
+            follow[f].born = true;
+            follow[f].alive = true;
+        }
+        if (!follow[f].alive) {
+            continue;
+        }
+        Species *s;
+        int i;
+        if (!identity_lookup(w, follow[f].handle, &s, &i)) {
+            fprintf(file, "Generation %d: animal %d is gone\n", gen, follow[f].id);
+            follow[f].alive = false;
+        } else if (s == &w->rabbits) {
+            fprintf(file, "Generation %d: RABBIT %d at (%d, %d), age %d\n", gen, follow[f].id, s->x[i], s->y[i],
+                    s->age[i]);
+        } else {
+            fprintf(file, "Generation %d: FOX %d at (%d, %d), age %d, hunger %d\n", gen, follow[f].id, s->x[i],
+                    s->y[i], s->age[i], s->hunger[i]);
+        }
+    }
+}
+
+// Unless the colored sweep was asked for, movers claim their targets while
+// collecting and no separate resolve pass is needed
+void simulate_generation(World *w, int gen) {
+    collect_moves_rabbits(w, gen, !w->colored);
+    if (w->colored) {
+        resolve_conflicts(w, &w->rabbits);
+    }
+    apply_moves_rabbits(w);
+
+    collect_moves_foxes(w, gen, !w->colored);
+    if (w->colored) {
+        resolve_conflicts(w, &w->foxes);
+    }
+    apply_moves_foxes(w);
+}
+
+// Copy the animals of s that live in rows [row_lo, row_hi) into d
+void species_copy_rows(World *dst, Species *d, const Species *s, int row_lo, int row_hi) {
+    for (int i = 0; i < s->count; i++) {
+        if (s->x[i] < row_lo || s->x[i] >= row_hi) {
+            continue;
+        }
+        int k = species_add(d, s->id[i], s->x[i], s->y[i]);
+        d->age[k] = s->age[i];
+        d->hunger[k] = s->hunger[i];
+        dst->object_index[CELL(dst, s->x[i], s->y[i])] = k;
+    }
+}
+
+// Spatial domain decomposition: the world is cut into horizontal strips, one
+// per thread. A strip only touches its own rows plus one ghost row on each
+// side, refreshed from the neighbours at the start of every sub-generation.
+// Movers that cross a boundary are handed to the strip that owns their
+// target cell, which resolves them together with its own movers.
+
+// An animal crossing a strip boundary, with the state it had before moving
+typedef struct {
+    int id;
+    int x, y;
+    int new_x, new_y;
+    int age;
+    int hunger;
+} Migrant;
+
+typedef struct {
+    World world;           // owned rows plus one ghost row on each side
+    Migrant *out[2];       // movers heading to the strip above [0] and below [1]
+    int out_count[2];
+    int core_lo, core_hi;  // rows this strip hands back to the world, its owned rows less any halo
+    long work;             // animals processed by this strip, summed over sub-generations
+    double wait;           // seconds spent waiting at barriers for the other strips
+} Strip;
+
+void strip_alloc_migrants(Strip *strip) {
+    // Only vertical moves cross a boundary, so at most one mover per column
+    strip->out[0] = arena_xmalloc(strip->world.arena, strip->world.C * sizeof(Migrant));
+    strip->out[1] = arena_xmalloc(strip->world.arena, strip->world.C * sizeof(Migrant));
+    strip->out_count[0] = strip->out_count[1] = 0;
+}
+
+// Strip index owns rows [row_lo, row_hi); its memory comes from arena if
+// not NULL
+void strip_create(Strip *strip, const World *global, int index, int nstrips, int row_lo, int row_hi,
+                  Arena *arena) {
+    World *w = &strip->world;
+    w->R = global->R;
+    w->C = global->C;
+    w->N_GEN = global->N_GEN;
+    w->GEN_PROC_RABBITS = global->GEN_PROC_RABBITS;
+    w->GEN_PROC_FOXES = global->GEN_PROC_FOXES;
+    w->GEN_FOOD_FOXES = global->GEN_FOOD_FOXES;
+    w->colored = global->colored;
+    w->id_objetcs = global->id_objetcs;
+    world_layout(w, index, nstrips);
+    world_set_rows(w, row_lo, row_hi);
+    world_alloc_in(w, arena);
+
+    int first = w->row_lo > 0 ? w->row_lo - 1 : 0;
+    int last = w->row_hi < global->R ? w->row_hi + 1 : global->R;
+    for (int x = first; x < last; x++) {
+        memcpy(&w->ecosystem[CELL(w, x, 0)], &global->ecosystem[CELL(global, x, 0)], w->C);
+    }
+    for (int x = w->row_lo; x < w->row_hi; x++) {
+        for (int y = 0; y < w->C; y++) {
+            w->num_rocks += w->ecosystem[CELL(w, x, y)] == 'X';
+        }
+    }
+    species_copy_rows(w, &w->rabbits, &global->rabbits, row_lo, row_hi);
+    species_copy_rows(w, &w->foxes, &global->foxes, row_lo, row_hi);
+    world_count_tiles(w);
+    strip_alloc_migrants(strip);
+    strip->core_lo = row_lo;
+    strip->core_hi = row_hi;
+    strip->work = 0;
+    strip->wait = 0;
+}
+
+void strip_free(Strip *strip) {
+    world_free(&strip->world);
+    if (strip->world.arena) {
+        return;
+    }
+    free(strip->out[0]);
+    free(strip->out[1]);
+}
+
+// Copy the core rows of every strip back into the world. Rocks never move,
+// so the world's rock count stays as it is.
+void strips_gather(Strip *strips, int nstrips, World *global) {
+    global->rabbits.count = 0;
+    global->foxes.count = 0;
+    for (int t = 0; t < nstrips; t++) {
+        World *w = &strips[t].world;
+        int lo = strips[t].core_lo, hi = strips[t].core_hi;
+        for (int x = lo; x < hi; x++) {
+            memcpy(&global->ecosystem[CELL(global, x, 0)], &w->ecosystem[CELL(w, x, 0)], w->C);
+            memset(&global->object_index[CELL(global, x, 0)], -1, w->C * sizeof(int));
+        }
+        species_copy_rows(global, &global->rabbits, &w->rabbits, lo, hi);
+        species_copy_rows(global, &global->foxes, &w->foxes, lo, hi);
+        if (w->id_objetcs > global->id_objetcs) {
+            global->id_objetcs = w->id_objetcs;
+        }
+    }
+    world_count_tiles(global);
+}
+
+// Refresh the ghost rows from the boundary rows of the neighbouring strips
+void strip_exchange_ghost_rows(Strip *strips, int t, int nstrips) {
+    World *w = &strips[t].world;
+    if (t > 0) {
+        World *up = &strips[t - 1].world;
+        memcpy(&w->ecosystem[CELL(w, w->row_lo - 1, 0)], &up->ecosystem[CELL(up, up->row_hi - 1, 0)], w->C);
+    }
+    if (t < nstrips - 1) {
+        World *down = &strips[t + 1].world;
+        memcpy(&w->ecosystem[CELL(w, w->row_hi, 0)], &down->ecosystem[CELL(down, down->row_lo, 0)], w->C);
+    }
+}
+
+// Pack the movers whose target lies outside the strip. They leave their cell
+// like conflict losers during apply and are then dropped by compaction.
+void strip_emigrate(Strip *strip, Species *s) {
+    World *w = &strip->world;
+    strip->out_count[0] = strip->out_count[1] = 0;
+    for (int i = 0; i < s->count; i++) {
+        if (!s->move_requested[i] || (s->new_x[i] >= w->row_lo && s->new_x[i] < w->row_hi)) {
+            continue;
+        }
+        int dir = s->new_x[i] < w->row_lo ? 0 : 1;
+        strip->out[dir][strip->out_count[dir]++] = (Migrant){
+            s->id[i], s->x[i], s->y[i], s->new_x[i], s->new_y[i], s->age[i], s->hunger[i]
+        };
+        s->dead[i] = true;
+    }
+}
+
+// Append an incoming mover; it competes for its target in resolve_conflicts
+void species_add_migrant(Species *s, const Migrant *m) {
+    int i = species_add(s, m->id, m->x, m->y);
+    s->age[i] = m->age;
+    s->hunger[i] = m->hunger;
+    s->new_x[i] = m->new_x;
+    s->new_y[i] = m->new_y;
+    s->move_requested[i] = true;
+}
+
+void strip_immigrate(Strip *strips, int t, int nstrips, bool foxes) {
+    World *w = &strips[t].world;
+    Species *s = foxes ? &w->foxes : &w->rabbits;
+    if (t > 0) {
+        for (int k = 0; k < strips[t - 1].out_count[1]; k++) {
+            species_add_migrant(s, &strips[t - 1].out[1][k]);
+        }
+    }
+    if (t < nstrips - 1) {
+        for (int k = 0; k < strips[t + 1].out_count[0]; k++) {
+            species_add_migrant(s, &strips[t + 1].out[0][k]);
+        }
+    }
+}
+
+// Barrier of the strip team, timed to expose load imbalance
+static inline void strip_barrier(Strip *strip) {
+    double start = omp_get_wtime();
+    #pragma omp barrier
+    strip->wait += omp_get_wtime() - start;
+}
+
+// One generation of strip t; called by every thread of the strip team.
+// The barrier after collecting publishes the migrants, the one after
+// applying publishes the boundary rows read by the next ghost exchange.
+void simulate_generation_strip(Strip *strips, int t, int nstrips, int gen) {
+    World *w = &strips[t].world;
+
+    strip_exchange_ghost_rows(strips, t, nstrips);
+    strips[t].work += w->rabbits.count;
+    collect_moves_rabbits(w, gen, false);
+    strip_emigrate(&strips[t], &w->rabbits);
+    strip_barrier(&strips[t]);
+    strip_immigrate(strips, t, nstrips, false);
+    resolve_conflicts(w, &w->rabbits);
+    apply_moves_rabbits(w);
+    strip_barrier(&strips[t]);
+
+    strip_exchange_ghost_rows(strips, t, nstrips);
+    strips[t].work += w->foxes.count;
+    collect_moves_foxes(w, gen, false);
+    strip_emigrate(&strips[t], &w->foxes);
+    strip_barrier(&strips[t]);
+    strip_immigrate(strips, t, nstrips, true);
+    resolve_conflicts(w, &w->foxes);
+    apply_moves_foxes(w);
+    strip_barrier(&strips[t]);
+}
+
+// Cut rows [0, R) into nstrips strips holding about the same number of
+// animals: a prefix sum over the animals of every row puts each cut where
+// the running total reaches the strip's share. Every strip keeps a row.
+void balance_rows(const World *w, int nstrips, int *bounds) {
+    int R = w->R;
+    long *prefix = xmalloc((R + 1) * sizeof(long));
+    memset(prefix, 0, (R + 1) * sizeof(long));
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->rabbits.count; i++) {
+        #pragma omp atomic
+        prefix[w->rabbits.x[i] + 1]++;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->foxes.count; i++) {
+        #pragma omp atomic
+        prefix[w->foxes.x[i] + 1]++;
+    }
+    for (int r = 0; r < R; r++) {
+        prefix[r + 1] += prefix[r];
+    }
+
+    bounds[0] = 0;
+    bounds[nstrips] = R;
+    int r = 0;
+    for (int k = 1; k < nstrips; k++) {
+        long share = prefix[R] * k / nstrips;
+        while (r < R && prefix[r] < share) {
+            r++;
+        }
+        int lo = bounds[k - 1] + 1;
+        int hi = R - (nstrips - k);
+        bounds[k] = r = r < lo ? lo : r > hi ? hi : r;
+    }
+    free(prefix);
+}
+
+// Strip engine options
+typedef struct {
+    bool balance;          // cut strips by population instead of by rows
+    int rebalance;         // generations between new cuts, 0 to keep the first ones
+    bool report;           // print the work of every strip to stderr
+    int temporal;          // generations per block with halos, 0 or 1 to exchange every sub-generation
+} StripOptions;
+
+// Temporal blocking: instead of exchanging ghost rows every sub-generation,
+// a strip copies TEMPORAL_HALO rows per generation beyond its own on each
+// side and runs a whole block of generations alone. A sub-generation only
+// reaches two rows (movers look one row ahead, their claims another one),
+// so after k generations the rows that may be wrong stop 4k rows out from
+// the strip; its own rows match the step-by-step run. Rows past the halo
+// are walled off with rocks.
+#define TEMPORAL_HALO 4
+
+void strip_create_halo(Strip *strip, const World *global, int index, int nstrips, int row_lo, int row_hi,
+                       int halo, Arena *arena) {
+    int lo = row_lo - halo > 0 ? row_lo - halo : 0;
+    int hi = row_hi + halo < global->R ? row_hi + halo : global->R;
+    strip_create(strip, global, index, nstrips, lo, hi, arena);
+    World *w = &strip->world;
+    if (lo > 0) {
+        memset(&w->ecosystem[CELL(w, lo - 1, 0)], 'X', w->C);
+    }
+    if (hi < global->R) {
+        memset(&w->ecosystem[CELL(w, hi, 0)], 'X', w->C);
+    }
+    strip->core_lo = row_lo;
+    strip->core_hi = row_hi;
+}
+
+// Generations [gen, last) of strip t on its own, halo included
+void simulate_block_strip(Strip *strip, int gen, int last) {
+    World *w = &strip->world;
+    for (int g = gen; g < last; g++) {
+        strip->work += w->rabbits.count + w->foxes.count;
+        simulate_generation(w, g);
+    }
+}
+
+// Rows, work and time of every strip. Busy time is wall time minus the
+// time spent at barriers; imbalance is the busiest strip over the average.
+void strips_report(const Strip *strips, int nstrips, const long *work, const double *wait, double elapsed) {
+    long work_sum = 0, work_max = 0;
+    double busy_sum = 0, busy_max = 0;
+    fprintf(stderr, "%-6s %8s %10s %14s %12s %12s\n", "strip", "rows", "animals", "work", "busy (s)", "wait (s)");
+    for (int t = 0; t < nstrips; t++) {
+        const Strip *strip = &strips[t];
+        int animals = 0;
+        for (int i = 0; i < strip->world.rabbits.count; i++) {
+            animals += strip->world.rabbits.x[i] >= strip->core_lo && strip->world.rabbits.x[i] < strip->core_hi;
+        }
+        for (int i = 0; i < strip->world.foxes.count; i++) {
+            animals += strip->world.foxes.x[i] >= strip->core_lo && strip->world.foxes.x[i] < strip->core_hi;
+        }
+        double busy = elapsed - wait[t];
+        fprintf(stderr, "%-6d %8d %10d %14ld %12.6f %12.6f\n", t, strip->core_hi - strip->core_lo,
+                animals, work[t], busy, wait[t]);
+        work_sum += work[t];
+        work_max = work[t] > work_max ? work[t] : work_max;
+        busy_sum += busy;
+        busy_max = busy > busy_max ? busy : busy_max;
+    }
+    fprintf(stderr, "imbalance: work %.2f, busy %.2f\n",
+            work_sum > 0 ? (double)work_max * nstrips / work_sum : 1.0,
+            busy_sum > 0 ? busy_max * nstrips / busy_sum : 1.0);
+}
+
+void simulate_strips(World *world, int first_gen, const StripOptions *options) {
+    int nstrips = omp_get_max_threads();
+    if (nstrips > world->R) {
+        nstrips = world->R;
+    }
+
+    Strip *strips = xmalloc(nstrips * sizeof(Strip));
+    Arena *arenas = xmalloc(nstrips * sizeof(Arena));
+    for (int t = 0; t < nstrips; t++) {
+        arena_init(&arenas[t]);
+    }
+    int *bounds = xmalloc((nstrips + 1) * sizeof(int));
+    long *work = xmalloc(nstrips * sizeof(long));
+    double *wait = xmalloc(nstrips * sizeof(double));
+    memset(work, 0, nstrips * sizeof(long));
+    memset(wait, 0, nstrips * sizeof(double));
+    double elapsed = 0;
+
+    // Each round runs with fixed cuts; rebalancing gathers the strips back
+    // into the world and cuts it again for the current population. With
+    // temporal blocking every block is a round of its own. Every thread
+    // builds its strip in its own arena, reset after each round.
+    bool temporal = options->temporal > 1;
+    int round = temporal ? options->temporal : options->rebalance;
+    for (int gen = first_gen; gen < world->N_GEN;) {
+        int last = round > 0 && gen + round < world->N_GEN ? gen + round : world->N_GEN;
+        for (int t = 0; t <= nstrips; t++) {
+            bounds[t] = (int)((long)world->R * t / nstrips);
+        }
+        if (options->balance) {
+            balance_rows(world, nstrips, bounds);
+        }
+
+        double start = omp_get_wtime();
+        #pragma omp parallel num_threads(nstrips)
+        {
+            if (omp_get_num_threads() != nstrips) {
+                fprintf(stderr, "Strip engine needs %d threads, got %d\n", nstrips, omp_get_num_threads());
+                exit(1);
+            }
+            int t = omp_get_thread_num();
+            if (temporal) {
+                strip_create_halo(&strips[t], world, t, nstrips, bounds[t], bounds[t + 1],
+                                  TEMPORAL_HALO * (last - gen), &arenas[t]);
+            } else {
+                strip_create(&strips[t], world, t, nstrips, bounds[t], bounds[t + 1], &arenas[t]);
+            }
+            // Neighbours read each other's boundary rows from here on
+            #pragma omp barrier
+
+            if (temporal) {
+                simulate_block_strip(&strips[t], gen, last);
+                strip_barrier(&strips[t]);
+            } else {
+                for (int g = gen; g < last; g++) {
+                    simulate_generation_strip(strips, t, nstrips, g);
+                }
+            }
+        }
+        elapsed += omp_get_wtime() - start;
+
+        strips_gather(strips, nstrips, world);
+        for (int t = 0; t < nstrips; t++) {
+            work[t] += strips[t].work;
+            wait[t] += strips[t].wait;
+        }
+        gen = last;
+        if (options->report && gen == world->N_GEN) {
+            strips_report(strips, nstrips, work, wait, elapsed);
+        }
+        for (int t = 0; t < nstrips; t++) {
+            strip_free(&strips[t]);
+            arena_reset(&arenas[t]);
+        }
+    }
+
+    for (int t = 0; t < nstrips; t++) {
+        arena_free(&arenas[t]);
+    }
+    free(arenas);
+    free(strips);
+    free(bounds);
+    free(work);
+    free(wait);
+}
+
+// Cell-centric engine: every sub-generation is two stencil sweeps over
+// the grid instead of loops over animals. The first gives every animal of
+// the moving species its direction, the second computes every cell from
+// its own state and the four neighbours that may move into it, the
+// winner being the mover with the highest age after the move and then,
+// for foxes, the lowest hunger. Remaining ties arrive with the same age
+// and hunger whichever wins, so the grids match the object engine's. The
+// grid is framed by rocks, so no cell needs a border test, and the inner
+// loops are free of branches for the compiler to vectorize across a row.
+// Ids are not tracked.
+
+enum { CA_EMPTY, CA_ROCK, CA_RABBIT, CA_FOX };
+#define CA_STAY -1         // no move this sub-generation
+#define CA_STARVE 4        // fox dies of hunger instead of moving
+
+typedef struct {
+    int R, C;
+    int P;                 // padded row length, C + 2
+    unsigned char *type[2];
+    int *age[2];
+    int *hunger[2];
+    signed char *dir;      // direction of the animal in each cell, or CA_STAY / CA_STARVE
+    unsigned char *mod12;  // mod12[y] = y % 12, for the move choice
+} CellWorld;
+
+// Padded index of cell (x, y)
+#define CA_CELL(ca, x, y) (((x) + 1) * (ca)->P + (y) + 1)
+
+static const unsigned char ca_types[128] = {['.'] = CA_EMPTY, ['X'] = CA_ROCK, ['R'] = CA_RABBIT, ['F'] = CA_FOX};
+static const char ca_chars[4] = {'.', 'X', 'R', 'F'};
+
+void ca_load(CellWorld *ca, const World *w) {
+    ca->R = w->R;
+    ca->C = w->C;
+    ca->P = w->C + 2;
+    size_t cells = (size_t)(w->R + 2) * ca->P;
+    for (int k = 0; k < 2; k++) {
+        ca->type[k] = xmalloc(cells);
+        ca->age[k] = xmalloc(cells * sizeof(int));
+        ca->hunger[k] = xmalloc(cells * sizeof(int));
+        memset(ca->type[k], CA_ROCK, cells);
+        memset(ca->age[k], 0, cells * sizeof(int));
+        memset(ca->hunger[k], 0, cells * sizeof(int));
+    }
+    ca->dir = xmalloc(cells);
+    memset(ca->dir, CA_STAY, cells);
+    ca->mod12 = xmalloc(w->C);
+    for (int y = 0; y < w->C; y++) {
+        ca->mod12[y] = y % 12;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int x = 0; x < w->R; x++) {
+        for (int y = 0; y < w->C; y++) {
+            ca->type[0][CA_CELL(ca, x, y)] = ca_types[(unsigned char)w->ecosystem[CELL(w, x, y)]];
+        }
+    }
+    const Species *species[2] = {&w->rabbits, &w->foxes};
+    for (int k = 0; k < 2; k++) {
+        const Species *s = species[k];
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < s->count; i++) {
+            ca->age[0][CA_CELL(ca, s->x[i], s->y[i])] = s->age[i];
+            ca->hunger[0][CA_CELL(ca, s->x[i], s->y[i])] = s->hunger[i];
+        }
+    }
+}
+
+// Put the grid back into w, with the animals renumbered in row-major order
+void ca_store(const CellWorld *ca, World *w) {
+    const unsigned char *type = ca->type[0];
+    w->rabbits.count = 0;
+    w->foxes.count = 0;
+    for (int x = 0; x < ca->R; x++) {
+        for (int y = 0; y < ca->C; y++) {
+            unsigned char t = type[CA_CELL(ca, x, y)];
+            Species *s = t == CA_RABBIT ? &w->rabbits : t == CA_FOX ? &w->foxes : NULL;
+            int cell = CELL(w, x, y);
+            w->ecosystem[cell] = ca_chars[t];
+            w->object_index[cell] = -1;
+            if (s) {
+                int i = species_add(s, ++w->id_objetcs, x, y);
+                s->age[i] = ca->age[0][CA_CELL(ca, x, y)];
+                s->hunger[i] = ca->hunger[0][CA_CELL(ca, x, y)];
+                w->object_index[cell] = i;
+            }
+        }
+    }
+    world_count_tiles(w);
+}
+
+void ca_free(CellWorld *ca) {
+    for (int k = 0; k < 2; k++) {
+        free(ca->type[k]);
+        free(ca->age[k]);
+        free(ca->hunger[k]);
+    }
+    free(ca->dir);
+    free(ca->mod12);
+}
+
+// c ? a : b for c in {0, 1}, as arithmetic: GCC does not if-convert
+// every ?: in these loops and then gives up on vectorizing them
+static inline int ca_select(int c, int a, int b) {
+    return b ^ ((a ^ b) & -c);
+}
+
+// pick_direction without the table: the (m12 % count)-th set bit of the
+// mask b0..b3, or CA_STAY when it is empty. m12 % 3 is (m12 * 11) >> 5
+// below 12.
+static inline int ca_pick(int b0, int b1, int b2, int b3, int m12) {
+    int count = b0 + b1 + b2 + b3;
+    int n = ca_select(count == 3, m12 - 3 * ((m12 * 11) >> 5), m12 & (count - 1));
+    int d = (b1 & (b0 == n)) + 2 * (b2 & (b0 + b1 == n)) + 3 * (b3 & (b0 + b1 + b2 == n));
+    return d - (count == 0);
+}
+
+// Directions of the animals of `mover` in row x; foxes go for rabbits
+// first and starve without them once hungry enough
+static inline void ca_directions(CellWorld *ca, const unsigned char *type, const int *hunger, int x, int gen,
+                                 int mover, int gen_food) {
+    int P = ca->P;
+    int C = ca->C;
+    int base = (gen + x) % 12;
+    int fox = mover == CA_FOX;
+    const unsigned char *restrict mod12 = ca->mod12;
+    const unsigned char *restrict row = &type[CA_CELL(ca, x, 0)];
+    const int *restrict row_hunger = &hunger[CA_CELL(ca, x, 0)];
+    signed char *restrict row_dir = &ca->dir[CA_CELL(ca, x, 0)];
+    #pragma omp simd
+    for (int y = 0; y < C; y++) {
+        int m12 = base + mod12[y];
+        m12 -= 12 & -(m12 >= 12);
+        int free_d = ca_pick(row[y - P] == CA_EMPTY, row[y + 1] == CA_EMPTY, row[y + P] == CA_EMPTY,
+                             row[y - 1] == CA_EMPTY, m12);
+        int prey_d = ca_pick(fox & (row[y - P] == CA_RABBIT), fox & (row[y + 1] == CA_RABBIT),
+                             fox & (row[y + P] == CA_RABBIT), fox & (row[y - 1] == CA_RABBIT), m12);
+        int starving = fox & (row_hunger[y] + 1 >= gen_food);
+        int d = ca_select(prey_d != CA_STAY, prey_d, ca_select(starving, CA_STARVE, free_d));
+        row_dir[y] = ca_select(row[y] == mover, d, CA_STAY);
+    }
+}
+
+// Offer a mover, arriving with age a and hunger h, to the best so far
+static inline void ca_offer(int arrives, int a, int h, int *found, int *best_age, int *best_hunger) {
+    int better = arrives & (!*found | (a > *best_age) | ((a == *best_age) & (h < *best_hunger)));
+    *best_age = ca_select(better, a, *best_age);
+    *best_hunger = ca_select(better, h, *best_hunger);
+    *found |= arrives;
+}
+
+// Age of an animal aged a after it moves
+static inline int ca_moved_age(int a, int gen_proc) {
+    return ca_select(a >= gen_proc, 0, a + 1);
+}
+
+// Next state of row x after the animals of `mover` moved
+static inline void ca_moves(CellWorld *ca, int x, int mover, int gen_proc) {
+    int P = ca->P;
+    int C = ca->C;
+    int c0 = CA_CELL(ca, x, 0);
+    const unsigned char *restrict type = &ca->type[0][c0];
+    const int *restrict age = &ca->age[0][c0];
+    const int *restrict hunger = &ca->hunger[0][c0];
+    const signed char *restrict dir = &ca->dir[c0];
+    unsigned char *restrict next_type = &ca->type[1][c0];
+    int *restrict next_age = &ca->age[1][c0];
+    int *restrict next_hunger = &ca->hunger[1][c0];
+    int fox = mover == CA_FOX;
+    #pragma omp simd
+    for (int y = 0; y < C; y++) {
+        // Movers arriving from the north, east, south and west
+        int found = 0, best_age = 0, best_hunger = 0;
+        ca_offer(dir[y - P] == 2, ca_moved_age(age[y - P], gen_proc), hunger[y - P], &found, &best_age, &best_hunger);
+        ca_offer(dir[y + 1] == 3, ca_moved_age(age[y + 1], gen_proc), hunger[y + 1], &found, &best_age, &best_hunger);
+        ca_offer(dir[y + P] == 0, ca_moved_age(age[y + P], gen_proc), hunger[y + P], &found, &best_age, &best_hunger);
+        ca_offer(dir[y - 1] == 1, ca_moved_age(age[y - 1], gen_proc), hunger[y - 1], &found, &best_age, &best_hunger);
+
+        int t = type[y];
+        int d = dir[y];
+        int stays = d == CA_STAY;
+        int leaves = t == mover && !stays;
+        int born = leaves & (d != CA_STARVE) & (age[y] >= gen_proc);
+        // A fox eating resets its hunger, any other move or stay adds one
+        int arrived_hunger = ca_select(fox & (t != CA_RABBIT), best_hunger + 1, 0);
+
+        int new_type = ca_select(found, mover, ca_select(leaves, ca_select(born, mover, CA_EMPTY), t));
+        int new_age = ca_select(found, best_age, ca_select(leaves, 0, age[y] + (t == mover)));
+        int new_hunger = ca_select(found, arrived_hunger, ca_select(leaves, 0, hunger[y] + (fox & (t == mover))));
+        next_type[y] = new_type;
+        next_age[y] = new_age;
+        next_hunger[y] = new_hunger;
+    }
+}
+
+static void ca_swap(CellWorld *ca) {
+    unsigned char *type = ca->type[0];
+    int *age = ca->age[0];
+    int *hunger = ca->hunger[0];
+    ca->type[0] = ca->type[1];
+    ca->age[0] = ca->age[1];
+    ca->hunger[0] = ca->hunger[1];
+    ca->type[1] = type;
+    ca->age[1] = age;
+    ca->hunger[1] = hunger;
+}
+
+// Simulate generations [first_gen, N_GEN) of w with the cell engine
+void simulate_cells(World *w, int first_gen) {
+    CellWorld ca;
+    ca_load(&ca, w);
+    int species[2] = {CA_RABBIT, CA_FOX};
+    int gen_proc[2] = {w->GEN_PROC_RABBITS, w->GEN_PROC_FOXES};
+
+    #pragma omp parallel
+    {
+        for (int gen = first_gen; gen < w->N_GEN; gen++) {
+            for (int k = 0; k < 2; k++) {
+                #pragma omp for schedule(static)
+                for (int x = 0; x < ca.R; x++) {
+                    ca_directions(&ca, ca.type[0], ca.hunger[0], x, gen, species[k], w->GEN_FOOD_FOXES);
+                }
+                #pragma omp for schedule(static)
+                for (int x = 0; x < ca.R; x++) {
+                    ca_moves(&ca, x, species[k], gen_proc[k]);
+                }
+                #pragma omp single
+                ca_swap(&ca);
+            }
+        }
+    }
+
+    ca_store(&ca, w);
+    ca_free(&ca);
+}
+
+// Binary checkpoints: the header below, the R*C grid padded to 8 bytes, then
+// x, y, age, hunger and id of every rabbit followed by the same for foxes.
+// The simulation thread serializes the state into a buffer and a helper
+// thread writes it out while the simulation carries on.
+
+#define CHECKPOINT_MAGIC "ECOCKPT1"
+
+typedef struct {
+    char magic[8];
+    int GEN_PROC_RABBITS, GEN_PROC_FOXES, GEN_FOOD_FOXES, N_GEN, R, C;
+    int generation;        // next generation to simulate
+    int id_objetcs;
+    int num_rocks;
+    int rabbits;
+    int foxes;
+    int padding;
+} CheckpointHeader;
+
+typedef struct {
+    const char *path;
+    int every;             // generations between checkpoints
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool pending;          // buffer holds a checkpoint not yet written
+    bool done;             // no more checkpoints, the writer should exit
+    char *buffer;
+    size_t size;
+    size_t capacity;
+} Checkpointer;
+
+static size_t checkpoint_grid_bytes(int R, int C) {
+    return ((size_t)R * C + 7) & ~(size_t)7;
+}
+
+static void *checkpoint_writer(void *arg) {
+    Checkpointer *ck = arg;
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", ck->path);
+
+    pthread_mutex_lock(&ck->lock);
+    for (;;) {
+        while (!ck->pending && !ck->done) {
+            pthread_cond_wait(&ck->cond, &ck->lock);
+        }
+        if (!ck->pending) {
+            break;
+        }
+        pthread_mutex_unlock(&ck->lock);
+
+        // Write next to the previous checkpoint and swap it in atomically
+        FILE *file = fopen(tmp_path, "wb");
+        if (!file || fwrite(ck->buffer, 1, ck->size, file) != ck->size || fclose(file) != 0 ||
+            rename(tmp_path, ck->path) != 0) {
+            perror("Error writing checkpoint");
+        }
+
+        pthread_mutex_lock(&ck->lock);
+        ck->pending = false;
+        pthread_cond_broadcast(&ck->cond);
+    }
+    pthread_mutex_unlock(&ck->lock);
+    return NULL;
+}
+
+void checkpoint_start(Checkpointer *ck, const char *path, int every) {
+    ck->path = path;
+    ck->every = every;
+    ck->pending = false;
+    ck->done = false;
+    ck->buffer = NULL;
+    ck->size = ck->capacity = 0;
+    pthread_mutex_init(&ck->lock, NULL);
+    pthread_cond_init(&ck->cond, NULL);
+    pthread_create(&ck->thread, NULL, checkpoint_writer, ck);
+}
+
+static char *put_species(char *p, const Species *s) {
+    size_t bytes = s->count * sizeof(int);
+    memcpy(p, s->x, bytes);
+    memcpy(p + bytes, s->y, bytes);
+    memcpy(p + 2 * bytes, s->age, bytes);
+    memcpy(p + 3 * bytes, s->hunger, bytes);
+    memcpy(p + 4 * bytes, s->id, bytes);
+    return p + 5 * bytes;
+}
+
+// Snapshot the state before `generation` for the writer thread. Only waits
+// if the previous checkpoint is still being written.
+void checkpoint_save(Checkpointer *ck, World *w, int generation) {
+    pthread_mutex_lock(&ck->lock);
+    while (ck->pending) {
+        pthread_cond_wait(&ck->cond, &ck->lock);
+    }
+    pthread_mutex_unlock(&ck->lock);
+
+    size_t grid = checkpoint_grid_bytes(w->R, w->C);
+    ck->size = sizeof(CheckpointHeader) + grid + 5 * sizeof(int) * ((size_t)w->rabbits.count + w->foxes.count);
+    if (ck->size > ck->capacity) {
+        free(ck->buffer);
+        ck->capacity = ck->size + ck->size / 4;
+        ck->buffer = xmalloc(ck->capacity);
+    }
+
+    CheckpointHeader header = {
+        CHECKPOINT_MAGIC, w->GEN_PROC_RABBITS, w->GEN_PROC_FOXES, w->GEN_FOOD_FOXES, w->N_GEN, w->R, w->C,
+        generation, w->id_objetcs, w->num_rocks, w->rabbits.count, w->foxes.count, 0
+    };
+    char *p = ck->buffer;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, &w->ecosystem[CELL(w, 0, 0)], (size_t)w->R * w->C);
+    memset(p + (size_t)w->R * w->C, 0, grid - (size_t)w->R * w->C);
+    p = put_species(p + grid, &w->rabbits);
+    put_species(p, &w->foxes);
+
+    pthread_mutex_lock(&ck->lock);
+    ck->pending = true;
+    pthread_cond_broadcast(&ck->cond);
+    pthread_mutex_unlock(&ck->lock);
+}
+
+// Wait for the last checkpoint to hit the disk and stop the writer
+void checkpoint_finish(Checkpointer *ck) {
+    pthread_mutex_lock(&ck->lock);
+    ck->done = true;
+    pthread_cond_broadcast(&ck->cond);
+    pthread_mutex_unlock(&ck->lock);
+    pthread_join(ck->thread, NULL);
+    pthread_mutex_destroy(&ck->lock);
+    pthread_cond_destroy(&ck->cond);
+    free(ck->buffer);
+}
+
+static const char *get_species(const char *p, Species *s, int count) {
+    size_t bytes = count * sizeof(int);
+    s->count = count;
+    memcpy(s->x, p, bytes);
+    memcpy(s->y, p + bytes, bytes);
+    memcpy(s->age, p + 2 * bytes, bytes);
+    memcpy(s->hunger, p + 3 * bytes, bytes);
+    memcpy(s->id, p + 4 * bytes, bytes);
+    memset(s->move_requested, 0, count * sizeof(bool));
+    memset(s->dead, 0, count * sizeof(bool));
+    return p + 5 * bytes;
+}
+
+// Animals [0, s->count) of a restored species that are off the grid or
+// not on a cell of their own type
+static int misplaced_animals(const World *w, const Species *s, char type) {
+    int misplaced = 0;
+    #pragma omp parallel for schedule(static) reduction(+:misplaced)
+    for (int i = 0; i < s->count; i++) {
+        int x = s->x[i], y = s->y[i];
+        misplaced += x < 0 || x >= w->R || y < 0 || y >= w->C || w->ecosystem[CELL(w, x, y)] != type;
+    }
+    return misplaced;
+}
+
+// Load a checkpoint into w and return the generation to continue from
+int checkpoint_restore(World *w, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("Error opening checkpoint");
+        exit(1);
+    }
+    size_t size = st.st_size;
+    const char *data = size >= sizeof(CheckpointHeader) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping checkpoint %s\n", path);
+        exit(1);
+    }
+
+    CheckpointHeader header;
+    memcpy(&header, data, sizeof(header));
+    // Live animals never outnumber the cells
+    long cells = (long)header.R * header.C;
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, 8) != 0 || header.R <= 0 || header.C <= 0 || cells > INT_MAX ||
+        header.rabbits < 0 || header.foxes < 0 || (long)header.rabbits + header.foxes > cells ||
+        size != sizeof(header) + checkpoint_grid_bytes(header.R, header.C) +
+                5 * sizeof(int) * ((size_t)header.rabbits + header.foxes)) {
+        fprintf(stderr, "Error: %s is not a valid checkpoint\n", path);
+        exit(1);
+    }
+
+    w->GEN_PROC_RABBITS = header.GEN_PROC_RABBITS;
+    w->GEN_PROC_FOXES = header.GEN_PROC_FOXES;
+    w->GEN_FOOD_FOXES = header.GEN_FOOD_FOXES;
+    w->N_GEN = header.N_GEN;
+    w->R = header.R;
+    w->C = header.C;
+    w->id_objetcs = header.id_objetcs;
+    w->colored = false;
+    world_layout(w, 0, 1);
+    world_alloc(w);
+    world_first_touch(w, header.rabbits, header.foxes);
+    w->num_rocks = header.num_rocks;
+
+    const char *p = data + sizeof(header);
+    memcpy(&w->ecosystem[CELL(w, 0, 0)], p, (size_t)w->R * w->C);
+    p = get_species(p + checkpoint_grid_bytes(w->R, w->C), &w->rabbits, header.rabbits);
+    get_species(p, &w->foxes, header.foxes);
+    if (misplaced_animals(w, &w->rabbits, 'R') || misplaced_animals(w, &w->foxes, 'F')) {
+        fprintf(stderr, "Error: %s is not a valid checkpoint\n", path);
+        exit(1);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->rabbits.count; i++) {
+        w->object_index[CELL(w, w->rabbits.x[i], w->rabbits.y[i])] = i;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < w->foxes.count; i++) {
+        w->object_index[CELL(w, w->foxes.x[i], w->foxes.y[i])] = i;
+    }
+    world_count_tiles(w);
+
+    munmap((void *)data, size);
+    return header.generation;
+}
+
+// Snapshots of the state every few generations, in the final-state format
+// with the remaining generations in the header, so each one can also seed
+// a new run (ages, hunger and ids are not part of that format, so it does
+// not continue the original one exactly; use checkpoints for that). The
+// simulation only copies the grid and its tile counts into a staging
+// area; a helper thread turns the copy into text and writes
+// <prefix>.<generation> while the next generations run. Like checkpoints,
+// a snapshot only waits for the previous one to be taken over by the
+// writer.
+
+typedef struct {
+    const char *prefix;
+    int every;             // generations between snapshots
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool pending;          // staging area holds a snapshot not yet taken over
+    bool done;             // no more snapshots, the writer should exit
+    int header[7];         // first line of the snapshot
+    int generation;
+    int R, C;
+    char *cells;           // staged grid, R * C
+    int *tile_count;       // staged tile counts
+    size_t tiles;
+} SnapshotWriter;
+
+static void *snapshot_writer(void *arg) {
+    SnapshotWriter *sw = arg;
+    char *cells = xmalloc((size_t)sw->R * sw->C);
+    int *tile_count = xmalloc(sw->tiles * sizeof(int));
+    char *columns = column_text(sw->C);
+    int tile_cols = (sw->C + TILE - 1) / TILE;
+    char *buf = NULL;
+    size_t capacity = 0;
+
+    pthread_mutex_lock(&sw->lock);
+    for (;;) {
+        while (!sw->pending && !sw->done) {
+            pthread_cond_wait(&sw->cond, &sw->lock);
+        }
+        if (!sw->pending) {
+            break;
+        }
+        // Take the snapshot over and let the simulation stage the next one
+        int header[7];
+        memcpy(header, sw->header, sizeof(header));
+        int generation = sw->generation;
+        memcpy(cells, sw->cells, (size_t)sw->R * sw->C);
+        memcpy(tile_count, sw->tile_count, sw->tiles * sizeof(int));
+        sw->pending = false;
+        pthread_cond_broadcast(&sw->cond);
+        pthread_mutex_unlock(&sw->lock);
+
+        size_t size = 7 * 12 + final_lines_size(header[6]);
+        if (size > capacity) {
+            free(buf);
+            capacity = size + size / 4;
+            buf = xmalloc(capacity);
+        }
+        char *p = buf;
+        for (int k = 0; k < 7; k++) {
+            p = put_int(p, header[k]);
+            *p++ = k < 6 ? ' ' : '\n';
+        }
+        for (int x = 0; x < sw->R; x++) {
+            p = render_final_row(p, &cells[(size_t)x * sw->C], x, sw->C, &tile_count[x / TILE * tile_cols], columns);
+        }
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.%d", sw->prefix, generation);
+        FILE *file = fopen(path, "w");
+        if (!file || fwrite(buf, 1, p - buf, file) != (size_t)(p - buf) || fclose(file) != 0) {
+            perror("Error writing snapshot");
+        }
+
+        pthread_mutex_lock(&sw->lock);
+    }
+    pthread_mutex_unlock(&sw->lock);
+    free(cells);
+    free(tile_count);
+    free(columns);
+    free(buf);
+    return NULL;
+}
+
+void snapshot_start(SnapshotWriter *sw, const World *w, const char *prefix, int every) {
+    sw->prefix = prefix;
+    sw->every = every;
+    sw->pending = false;
+    sw->done = false;
+    sw->R = w->R;
+    sw->C = w->C;
+    sw->tiles = (size_t)((w->R + TILE - 1) / TILE) * w->tile_cols;
+    sw->cells = xmalloc((size_t)w->R * w->C);
+    sw->tile_count = xmalloc(sw->tiles * sizeof(int));
+    pthread_mutex_init(&sw->lock, NULL);
+    pthread_cond_init(&sw->cond, NULL);
+    pthread_create(&sw->thread, NULL, snapshot_writer, sw);
+}
+
+// Stage the state before `generation` for the writer thread
+void snapshot_save(SnapshotWriter *sw, World *w, int generation) {
+    pthread_mutex_lock(&sw->lock);
+    while (sw->pending) {
+        pthread_cond_wait(&sw->cond, &sw->lock);
+    }
+    pthread_mutex_unlock(&sw->lock);
+
+    int header[7] = {w->GEN_PROC_RABBITS, w->GEN_PROC_FOXES, w->GEN_FOOD_FOXES, w->N_GEN - generation, w->R, w->C,
+                     w->num_rocks + w->rabbits.count + w->foxes.count};
+    memcpy(sw->header, header, sizeof(header));
+    sw->generation = generation;
+    memcpy(sw->cells, &w->ecosystem[CELL(w, 0, 0)], (size_t)w->R * w->C);
+    memcpy(sw->tile_count, w->tile_count, sw->tiles * sizeof(int));
+
+    pthread_mutex_lock(&sw->lock);
+    sw->pending = true;
+    pthread_cond_broadcast(&sw->cond);
+    pthread_mutex_unlock(&sw->lock);
+}
+
+// Write the last snapshot out and stop the writer
+void snapshot_finish(SnapshotWriter *sw) {
+    pthread_mutex_lock(&sw->lock);
+    sw->done = true;
+    pthread_cond_broadcast(&sw->cond);
+    pthread_mutex_unlock(&sw->lock);
+    pthread_join(sw->thread, NULL);
+    pthread_mutex_destroy(&sw->lock);
+    pthread_cond_destroy(&sw->cond);
+    free(sw->cells);
+    free(sw->tile_count);
+}
+
+// Output ring for traces: the simulation renders a generation into a free
+// slot and a helper thread writes the queued slots out, so formatting the
+// next generation overlaps with writing the previous ones. Without the
+// helper thread a slot is written as soon as it is submitted.
+
+#define RING_SLOTS 4
+
+typedef struct {
+    FILE *file;
+    bool async;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *slot[RING_SLOTS];
+    size_t length[RING_SLOTS];
+    int head;              // slots submitted so far
+    int tail;              // slots written so far
+    bool done;
+} OutputRing;
+
+static void *ring_writer(void *arg) {
+    OutputRing *ring = arg;
+    pthread_mutex_lock(&ring->lock);
+    for (;;) {
+        while (ring->tail == ring->head && !ring->done) {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        if (ring->tail == ring->head) {
+            break;
+        }
+        int k = ring->tail % RING_SLOTS;
+        pthread_mutex_unlock(&ring->lock);
+
+        fwrite(ring->slot[k], 1, ring->length[k], ring->file);
+
+        pthread_mutex_lock(&ring->lock);
+        ring->tail++;
+        pthread_cond_broadcast(&ring->cond);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return NULL;
+}
+
+// Preallocate slots of slot_size bytes, the most a single render can take
+void ring_open(OutputRing *ring, FILE *file, bool async, size_t slot_size) {
+    ring->file = file;
+    ring->async = async;
+    ring->head = ring->tail = 0;
+    ring->done = false;
+    for (int k = 0; k < RING_SLOTS; k++) {
+        ring->slot[k] = xmalloc(slot_size);
+    }
+    if (async) {
+        pthread_mutex_init(&ring->lock, NULL);
+        pthread_cond_init(&ring->cond, NULL);
+        pthread_create(&ring->thread, NULL, ring_writer, ring);
+    }
+}
+
+// Next slot to render into; waits while every slot is queued for writing
+char *ring_acquire(OutputRing *ring) {
+    if (ring->async) {
+        pthread_mutex_lock(&ring->lock);
+        while (ring->head - ring->tail == RING_SLOTS) {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return ring->slot[ring->head % RING_SLOTS];
+}
+
+void ring_submit(OutputRing *ring, size_t length) {
+    int k = ring->head % RING_SLOTS;
+    ring->length[k] = length;
+    if (!ring->async) {
+        fwrite(ring->slot[k], 1, length, ring->file);
+        ring->head++;
+        return;
+    }
+    pthread_mutex_lock(&ring->lock);
+    ring->head++;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+// Write out everything still queued and release the slots
+void ring_close(OutputRing *ring) {
+    if (ring->async) {
+        pthread_mutex_lock(&ring->lock);
+        ring->done = true;
+        pthread_cond_broadcast(&ring->cond);
+        pthread_mutex_unlock(&ring->lock);
+        pthread_join(ring->thread, NULL);
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->cond);
+    }
+    fflush(ring->file);
+    for (int k = 0; k < RING_SLOTS; k++) {
+        free(ring->slot[k]);
+    }
+}
+
+// Render generation gen of w into the ring in the chosen trace layout
+void trace_generation(OutputRing *ring, World *w, int gen, bool compact) {
+    char *buf = ring_acquire(ring);
+    ring_submit(ring, compact ? render_ecosystem_compact(w, gen, buf) : render_ecosystem(w, gen, buf));
+}
+
+// Batch runs: the world is loaded once and every scenario, a set of
+// parameters, simulates its own copy of it. Scenarios run concurrently,
+// the threads split between them, and their final states are printed in
+// scenario order. Rocks are not shared between the copies: they sit in
+// the same grid the animals move through, so a copy holds the whole grid
+// (9 bytes per cell with object_index and claims) plus species sized to
+// its population. Copies are made when a scenario starts and freed when it
+// ends, so only the scenarios running at the same time hold one.
+
+typedef struct {
+    int GEN_PROC_RABBITS, GEN_PROC_FOXES, GEN_FOOD_FOXES, N_GEN;
+} Scenario;
+
+// One scenario per line: GEN_PROC_RABBITS GEN_PROC_FOXES GEN_FOOD_FOXES
+// and optionally N_GEN, which defaults to the input's. Blank lines and
+// lines starting with '#' are skipped.
+Scenario *read_scenarios(const char *path, const World *w, int *count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror("Error opening scenario file");
+        exit(1);
+    }
+    int capacity = 16;
+    Scenario *scenarios = xmalloc(capacity * sizeof(Scenario));
+    char line[256];
+    int n = 0, lineno = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineno++;
+        const char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        Scenario sc = {0, 0, 0, w->N_GEN};
+        if (sscanf(p, "%d %d %d %d", &sc.GEN_PROC_RABBITS, &sc.GEN_PROC_FOXES, &sc.GEN_FOOD_FOXES, &sc.N_GEN) < 3 ||
+            sc.N_GEN < 0) {
+            fprintf(stderr, "Error reading scenario on line %d of %s\n", lineno, path);
+            exit(1);
+        }
+        if (n == capacity) {
+            capacity *= 2;
+            scenarios = realloc(scenarios, capacity * sizeof(Scenario));
+            if (!scenarios) {
+                perror("Memory allocation failed");
+                exit(1);
+            }
+        }
+        scenarios[n++] = sc;
+    }
+    fclose(file);
+    *count = n;
+    return scenarios;
+}
+
+void run_scenarios(const World *world, const Scenario *scenarios, int count) {
+    char **results = xmalloc(count * sizeof(char *));
+    size_t *lengths = xmalloc(count * sizeof(size_t));
+
+    // Threads left over once every scenario has one go to the scenarios'
+    // own parallel loops
+    int nthreads = omp_get_max_threads();
+    int inner = count < nthreads ? nthreads / count : 1;
+    if (inner > 1) {
+        omp_set_max_active_levels(2);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < count; k++) {
+        omp_set_num_threads(inner);
+        World w;
+        world_copy(&w, world);
+        w.GEN_PROC_RABBITS = scenarios[k].GEN_PROC_RABBITS;
+        w.GEN_PROC_FOXES = scenarios[k].GEN_PROC_FOXES;
+        w.GEN_FOOD_FOXES = scenarios[k].GEN_FOOD_FOXES;
+        w.N_GEN = scenarios[k].N_GEN;
+
+        double start = omp_get_wtime();
+        for (int gen = 0; gen < w.N_GEN; gen++) {
+            simulate_generation(&w, gen);
+        }
+        double elapsed = omp_get_wtime() - start;
+
+        FILE *out = open_memstream(&results[k], &lengths[k]);
+        if (!out) {
+            perror("Error opening scenario output");
+            exit(1);
+        }
+        fprintf(out, "# scenario %d: %d %d %d %d\n", k, w.GEN_PROC_RABBITS, w.GEN_PROC_FOXES, w.GEN_FOOD_FOXES,
+                w.N_GEN);
+        print_final_state(&w, out);
+        fclose(out);
+        fprintf(stderr, "Scenario %d: %d rabbits, %d foxes, %.6f seconds\n", k, w.rabbits.count, w.foxes.count,
+                elapsed);
+        world_free(&w);
+    }
+
+    for (int k = 0; k < count; k++) {
+        fwrite(results[k], 1, lengths[k], stdout);
+        free(results[k]);
+    }
+    free(results);
+    free(lengths);
+}
+
+#ifdef USE_MPI
+// Distributed build (mpicc -DUSE_MPI -fopenmp eco.c): every rank runs one
+// strip of the decomposition above, reading only its rows of the input, and
+// talks to its neighbours with nonblocking messages instead of shared memory.
+// OpenMP threads still split the phase loops inside a rank.
+
+#define TAG_GHOST 1
+#define TAG_MIGRANTS 2
+#define TAG_FINAL 3
+
+void mpi_exchange_ghost_rows(World *w, int rank, int size) {
+    MPI_Request reqs[4];
+    int n = 0;
+    if (rank > 0) {
+        MPI_Irecv(&w->ecosystem[CELL(w, w->row_lo - 1, 0)], w->C, MPI_CHAR, rank - 1, TAG_GHOST, MPI_COMM_WORLD, &reqs[n++]);
+        MPI_Isend(&w->ecosystem[CELL(w, w->row_lo, 0)], w->C, MPI_CHAR, rank - 1, TAG_GHOST, MPI_COMM_WORLD, &reqs[n++]);
+    }
+    if (rank < size - 1) {
+        MPI_Irecv(&w->ecosystem[CELL(w, w->row_hi, 0)], w->C, MPI_CHAR, rank + 1, TAG_GHOST, MPI_COMM_WORLD, &reqs[n++]);
+        MPI_Isend(&w->ecosystem[CELL(w, w->row_hi - 1, 0)], w->C, MPI_CHAR, rank + 1, TAG_GHOST, MPI_COMM_WORLD, &reqs[n++]);
+    }
+    MPI_Waitall(n, reqs, MPI_STATUSES_IGNORE);
+}
+
+// Swap emigrants with both neighbours and append the incoming ones to s.
+// in[0] and in[1] receive from the rank above and below.
+void mpi_exchange_migrants(Strip *strip, Species *s, Migrant *in[2], int rank, int size) {
+    int C = strip->world.C;
+    MPI_Request reqs[4];
+    MPI_Status status[4];
+    int recv_slot[2] = {-1, -1};
+    int n = 0;
+    if (rank > 0) {
+        recv_slot[0] = n;
+        MPI_Irecv(in[0], C * sizeof(Migrant), MPI_BYTE, rank - 1, TAG_MIGRANTS, MPI_COMM_WORLD, &reqs[n++]);
+        MPI_Isend(strip->out[0], strip->out_count[0] * sizeof(Migrant), MPI_BYTE, rank - 1, TAG_MIGRANTS, MPI_COMM_WORLD, &reqs[n++]);
+    }
+    if (rank < size - 1) {
+        recv_slot[1] = n;
+        MPI_Irecv(in[1], C * sizeof(Migrant), MPI_BYTE, rank + 1, TAG_MIGRANTS, MPI_COMM_WORLD, &reqs[n++]);
+        MPI_Isend(strip->out[1], strip->out_count[1] * sizeof(Migrant), MPI_BYTE, rank + 1, TAG_MIGRANTS, MPI_COMM_WORLD, &reqs[n++]);
+    }
+    MPI_Waitall(n, reqs, status);
+
+    for (int d = 0; d < 2; d++) {
+        if (recv_slot[d] < 0) {
+            continue;
+        }
+        int bytes;
+        MPI_Get_count(&status[recv_slot[d]], MPI_BYTE, &bytes);
+        for (int k = 0; k < bytes / (int)sizeof(Migrant); k++) {
+            species_add_migrant(s, &in[d][k]);
+        }
+    }
+}
+
+// Same steps as simulate_generation_strip, with messages instead of barriers
+void simulate_generation_mpi(Strip *strip, Migrant *in[2], int rank, int size, int gen) {
+    World *w = &strip->world;
+
+    mpi_exchange_ghost_rows(w, rank, size);
+    collect_moves_rabbits(w, gen, false);
+    strip_emigrate(strip, &w->rabbits);
+    mpi_exchange_migrants(strip, &w->rabbits, in, rank, size);
+    resolve_conflicts(w, &w->rabbits);
+    apply_moves_rabbits(w);
+
+    mpi_exchange_ghost_rows(w, rank, size);
+    collect_moves_foxes(w, gen, false);
+    strip_emigrate(strip, &w->foxes);
+    mpi_exchange_migrants(strip, &w->foxes, in, rank, size);
+    resolve_conflicts(w, &w->foxes);
+    apply_moves_foxes(w);
+}
+
+// Rank 0 prints the header and then every rank's rows in order, one strip
+// in memory at a time
+void mpi_print_final_state(World *w, int rank, int size) {
+    int local = w->num_rocks + w->rabbits.count + w->foxes.count;
+    int num_objects = 0;
+    MPI_Reduce(&local, &num_objects, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    int nrows = w->row_hi - w->row_lo;
+    char *own = &w->ecosystem[CELL(w, w->row_lo, 0)];
+    if (rank != 0) {
+        MPI_Send(own, nrows * w->C, MPI_CHAR, 0, TAG_FINAL, MPI_COMM_WORLD);
+        return;
+    }
+
+    printf("%d %d %d %d %d %d %d\n", w->GEN_PROC_RABBITS, w->GEN_PROC_FOXES, w->GEN_FOOD_FOXES, 0, w->R, w->C, num_objects);
+    print_final_rows(stdout, own, w->row_lo, nrows, w->C, w->tile_count);
+    char *rows = xmalloc(((long)w->R / size + 1) * w->C);
+    for (int r = 1; r < size; r++) {
+        int row_lo = (int)((long)w->R * r / size);
+        int row_hi = (int)((long)w->R * (r + 1) / size);
+        MPI_Recv(rows, (row_hi - row_lo) * w->C, MPI_CHAR, r, TAG_FINAL, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        print_final_rows(stdout, rows, row_lo, row_hi - row_lo, w->C, NULL);
+    }
+    free(rows);
+}
+
+int main(int argc, char* argv[]) {
+    int provided, rank, size;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (argc != 2) {
+        if (rank == 0) {
+            fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    Strip strip;
+    read_input(&strip.world, argv[1], rank, size);
+    if (size > strip.world.R) {
+        if (rank == 0) {
+            fprintf(stderr, "Error: %d ranks for only %d rows\n", size, strip.world.R);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    strip_alloc_migrants(&strip);
+    Migrant *in[2] = {xmalloc(strip.world.C * sizeof(Migrant)), xmalloc(strip.world.C * sizeof(Migrant))};
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_time = MPI_Wtime();
+
+    for (int gen = 0; gen < strip.world.N_GEN; gen++) {
+        simulate_generation_mpi(&strip, in, rank, size, gen);
+    }
+
+    double elapsed_time = MPI_Wtime() - start_time;
+    double max_time;
+    MPI_Reduce(&elapsed_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        fprintf(stderr, "Execution Time: %.6f seconds\n", max_time);
+    }
+
+    mpi_print_final_state(&strip.world, rank, size);
+    free(in[0]);
+    free(in[1]);
+    strip_free(&strip);
+
+    MPI_Finalize();
+    return 0;
+}
+
+#else
+// Pin the threads with OMP_PROC_BIND=policy, on cores unless OMP_PLACES
+// says otherwise. The OpenMP runtime reads both when the program starts,
+// so they go into the environment and the program runs itself again.
+void bind_threads(const char *policy, char *argv[]) {
+    const char *current = getenv("OMP_PROC_BIND");
+    if (current && strcmp(current, policy) == 0) {
+        return;
+    }
+    setenv("OMP_PROC_BIND", policy, 1);
+    setenv("OMP_PLACES", "cores", 0);
+    execv("/proc/self/exe", argv);
+    perror("Error restarting with thread binding");
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    const char *input = NULL;
+    const char *engine = "object";
+    const char *resume = NULL;
+    const char *checkpoint_path = NULL;
+    int checkpoint_every = 0;
+    const char *snapshot_prefix = NULL;
+    int snapshot_every = 0;
+    const char *trace_path = NULL;
+    bool trace_compact = false;
+    bool trace_async = false;
+    const char *stats_path = NULL;
+    Follow *follow = xmalloc(argc * sizeof(Follow));
+    int follow_count = 0;
+    bool profile = false;
+    const char *profile_trace = NULL;
+    StripOptions strip_options = {true, 100, false, 0};
+    const char *scenarios_path = NULL;
+    bool strip_options_set = false;
+    bool colored = false;
+    const char *bind = NULL;
+    bool bad_args = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = argv[++i];
+        } else if (strcmp(argv[i], "--colored") == 0) {
+            colored = true;
+        } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bind = argv[++i];
+            bad_args |= strcmp(bind, "close") != 0 && strcmp(bind, "spread") != 0;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 2 < argc) {
+            checkpoint_every = atoi(argv[++i]);
+            checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 2 < argc) {
+            snapshot_every = atoi(argv[++i]);
+            snapshot_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+            resume = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace-compact") == 0) {
+            trace_compact = true;
+        } else if (strcmp(argv[i], "--trace-async") == 0) {
+            trace_async = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--follow") == 0 && i + 1 < argc) {
+            follow[follow_count++].id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+            profile = true;
+            profile_trace = argv[++i];
+        } else if (strcmp(argv[i], "--balance") == 0 && i + 1 < argc) {
+            i++;
+            strip_options.balance = strcmp(argv[i], "population") == 0;
+            bad_args |= !strip_options.balance && strcmp(argv[i], "rows") != 0;
+            strip_options_set = true;
+        } else if (strcmp(argv[i], "--rebalance") == 0 && i + 1 < argc) {
+            strip_options.rebalance = atoi(argv[++i]);
+            bad_args |= strip_options.rebalance < 0;
+            strip_options_set = true;
+        } else if (strcmp(argv[i], "--scenarios") == 0 && i + 1 < argc) {
+            scenarios_path = argv[++i];
+        } else if (strcmp(argv[i], "--temporal") == 0 && i + 1 < argc) {
+            strip_options.temporal = atoi(argv[++i]);
+            bad_args |= strip_options.temporal < 0;
+            strip_options_set = true;
+        } else if (strcmp(argv[i], "--strip-report") == 0) {
+            strip_options.report = true;
+            strip_options_set = true;
+        } else if (!input && argv[i][0] != '-') {
+            input = argv[i];
+        } else {
+            bad_args = true;
+        }
+    }
+    if (bad_args || !input == !resume ||
+        (strcmp(engine, "object") != 0 && strcmp(engine, "strips") != 0 && strcmp(engine, "cells") != 0) ||
+        (checkpoint_path && (checkpoint_every <= 0 || strcmp(engine, "object") != 0)) ||
+        (snapshot_prefix && (snapshot_every <= 0 || strcmp(engine, "object") != 0)) ||
+        ((trace_path || stats_path || profile || follow_count) && strcmp(engine, "object") != 0) ||
+        (strip_options_set && strcmp(engine, "strips") != 0) ||
+        (scenarios_path && (resume || checkpoint_path || snapshot_prefix || trace_path || stats_path || profile || follow_count ||
+                            strcmp(engine, "object") != 0))) {
+        fprintf(stderr, "Usage: %s [--engine object|strips|cells] [--colored] [--checkpoint <every> <file>]\n"
+                        "          [--snapshot <every> <prefix>]\n"
+                        "          [--trace <file|-> [--trace-compact] [--trace-async]] [--stats <file|->]\n"
+                        "          [--profile] [--profile-trace <file>] [--follow <id>]... [--bind close|spread]\n"
+                        "          [--balance rows|population] [--rebalance <every>] [--temporal <gens>] [--strip-report]\n"
+                        "          <input_file> | --resume <checkpoint_file>\n"
+                        "       %s [--colored] [--bind close|spread] --scenarios <scenario_file> <input_file>\n"
+                        "  --checkpoint, --snapshot, --trace, --stats, --profile and --follow are only supported by\n"
+                        "  the object engine,\n"
+                        "  --balance, --rebalance, --temporal and --strip-report only by the strips engine,\n"
+                        "  --bind pins threads to cores packed together (close) or across sockets (spread)\n",
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+    if (bind) {
+        bind_threads(bind, argv);
+    }
+
+    World world;
+    int first_gen = 0;
+    if (resume) {
+        first_gen = checkpoint_restore(&world, resume);
+    } else {
+        read_input(&world, input, 0, 1);
+    }
+    world.colored = colored;
+
+    if (scenarios_path) {
+        int count;
+        Scenario *scenarios = read_scenarios(scenarios_path, &world, &count);
+        double start = omp_get_wtime();
+        run_scenarios(&world, scenarios, count);
+        fprintf(stderr, "Execution Time: %.6f seconds\n", omp_get_wtime() - start);
+        free(scenarios);
+        free(follow);
+        world_free(&world);
+        return 0;
+    }
+
+    Checkpointer checkpointer;
+    if (checkpoint_path) {
+        checkpoint_start(&checkpointer, checkpoint_path, checkpoint_every);
+    }
+    SnapshotWriter snapshots;
+    if (snapshot_prefix) {
+        snapshot_start(&snapshots, &world, snapshot_prefix, snapshot_every);
+    }
+
+    // Per-generation trace in the allgen* layout, generation 0 included
+    OutputRing trace;
+    FILE *trace_file = NULL;
+    if (trace_path) {
+        trace_file = strcmp(trace_path, "-") == 0 ? stdout : fopen(trace_path, "w");
+        if (!trace_file) {
+            perror("Error opening trace file");
+            return 1;
+        }
+        ring_open(&trace, trace_file, trace_async,
+                  trace_compact ? ecosystem_compact_render_size(&world) : ecosystem_render_size(&world));
+        trace_generation(&trace, &world, first_gen, trace_compact);
+    }
+
+    FILE *stats_file = NULL;
+    if (stats_path) {
+        stats_file = strcmp(stats_path, "-") == 0 ? stdout : fopen(stats_path, "w");
+        if (!stats_file) {
+            perror("Error opening stats file");
+            return 1;
+        }
+        print_stats_header(stats_file);
+    }
+
+    // Followed animals are reported on stderr
+    IdentityTable identity;
+    if (follow_count) {
+        identity_attach(&world, &identity);
+        follow_start(&world, follow, follow_count);
+        follow_report(stderr, &world, follow, follow_count, first_gen);
+    }
+
+    Profiler profiler;
+    if (profile) {
+        profile_init(&profiler, profile_trace != NULL);
+        world.profile = &profiler;
+    }
+
+    struct timeval start_time, end_time;
+    gettimeofday(&start_time, NULL); // Start wall-clock time measurement
+
+    if (strcmp(engine, "strips") == 0) {
+        simulate_strips(&world, first_gen, &strip_options);
+    } else if (strcmp(engine, "cells") == 0) {
+        simulate_cells(&world, first_gen);
+    } else {
+        for (int gen = first_gen; gen < world.N_GEN; gen++) {
+            simulate_generation(&world, gen);
+            if (trace_path) {
+                trace_generation(&trace, &world, gen + 1, trace_compact);
+            }
+            if (stats_file) {
+                print_stats(stats_file, &world, gen + 1);
+            }
+            if (follow_count) {
+                follow_report(stderr, &world, follow, follow_count, gen + 1);
+            }
+            if (checkpoint_path && (gen + 1) % checkpoint_every == 0 && gen + 1 < world.N_GEN) {
+                checkpoint_save(&checkpointer, &world, gen + 1);
+            }
+            if (snapshot_prefix && (gen + 1) % snapshot_every == 0 && gen + 1 < world.N_GEN) {
+                snapshot_save(&snapshots, &world, gen + 1);
+            }
+        }
+    }
+
+    gettimeofday(&end_time, NULL); // End wall-clock time measurement
+
+    // Calculate elapsed time
+    double elapsed_time = (end_time.tv_sec - start_time.tv_sec) +
+                          (end_time.tv_usec - start_time.tv_usec) / 1e6;
+    fprintf(stderr, "Execution Time: %.6f seconds\n", elapsed_time);
+    if (profile) {
+        profile_report(&profiler, stderr);
+        if (profile_trace) {
+            profile_write_trace(&profiler, profile_trace);
+        }
+        world.profile = NULL;
+        profile_free(&profiler);
+    }
+
+    if (checkpoint_path) {
+        checkpoint_finish(&checkpointer);
+    }
+    if (snapshot_prefix) {
+        snapshot_finish(&snapshots);
+    }
+    if (trace_path) {
+        ring_close(&trace);
+        if (trace_file != stdout) {
+            fclose(trace_file);
+        }
+    }
+    if (stats_file && stats_file != stdout) {
+        fclose(stats_file);
+    }
+    print_final_state(&world, stdout);
+    if (follow_count) {
+        identity_detach(&world);
+    }
+    free(follow);
+    world_free(&world);
+
+    return 0;
+}
+
+#endif
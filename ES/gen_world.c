@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Seeded generator of ecosystem input files in the format read by eco:
+//   GEN_PROC_RABBITS GEN_PROC_FOXES GEN_FOOD_FOXES N_GEN R C N
+// followed by one "ROCK|RABBIT|FOX x y" line per object in row-major order.
+// Every cell independently becomes a rock, a rabbit or a fox with the given
+// densities, so the same arguments and seed always give the same world.
+
+// splitmix64: small, fast and identical on every platform
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in [0, 1)
+static double next_uniform(uint64_t *state) {
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <R> <C> <N_GEN> [--rocks <density>] [--rabbits <density>] [--foxes <density>]\n"
+                    "          [--proc-rabbits <gens>] [--proc-foxes <gens>] [--food-foxes <gens>] [--seed <n>]\n"
+                    "  densities are fractions of the cells, defaults 0.05 rocks, 0.20 rabbits, 0.05 foxes\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        usage(argv[0]);
+    }
+    int R = atoi(argv[1]);
+    int C = atoi(argv[2]);
+    int N_GEN = atoi(argv[3]);
+    double rocks = 0.05, rabbits = 0.20, foxes = 0.05;
+    int gen_proc_rabbits = 2, gen_proc_foxes = 4, gen_food_foxes = 3;
+    uint64_t seed = 1;
+    for (int i = 4; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        } else if (strcmp(argv[i], "--rocks") == 0) {
+            rocks = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rabbits") == 0) {
+            rabbits = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--foxes") == 0) {
+            foxes = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--proc-rabbits") == 0) {
+            gen_proc_rabbits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--proc-foxes") == 0) {
+            gen_proc_foxes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--food-foxes") == 0) {
+            gen_food_foxes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (R <= 0 || C <= 0 || N_GEN < 0 || rocks < 0 || rabbits < 0 || foxes < 0 ||
+        rocks + rabbits + foxes > 1) {
+        usage(argv[0]);
+    }
+
+    // Draw the whole grid first, the header needs the object count
+    char *cells = malloc((size_t)R * C);
+    if (!cells) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    long num_objects = 0;
+    uint64_t state = seed;
+    for (long k = 0; k < (long)R * C; k++) {
+        double u = next_uniform(&state);
+        cells[k] = u < rocks ? 'X' : u < rocks + rabbits ? 'R' : u < rocks + rabbits + foxes ? 'F' : '.';
+        num_objects += cells[k] != '.';
+    }
+
+    printf("%d %d %d %d %d %d %ld\n", gen_proc_rabbits, gen_proc_foxes, gen_food_foxes, N_GEN, R, C, num_objects);
+    for (int x = 0; x < R; x++) {
+        for (int y = 0; y < C; y++) {
+            char type = cells[(long)x * C + y];
+            if (type != '.') {
+                printf("%s %d %d\n", type == 'X' ? "ROCK" : type == 'R' ? "RABBIT" : "FOX", x, y);
+            }
+        }
+    }
+    free(cells);
+    return 0;
+}
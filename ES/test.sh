@@ -0,0 +1,132 @@
+#!/bin/bash
+# Regression test for eco.
+#
+# Runs eco on every input in this directory with every engine
+# configuration and thread count and compares the final state with the
+# matching output* reference. Inputs with an allgen* reference also get
+# their per-generation trace compared, and their compact trace, which
+# shows the ids, compared across thread counts. Every input is also run
+# with a checkpoint halfway and resumed from it at every thread count,
+# which must end in the same final state. With -m the MPI build is
+# checked the same way for every rank count, launched with $MPIRUN
+# (default mpirun). CC, MPICC and CFLAGS select the compilers and extra
+# flags. Exits with status 1 if any check fails, so it can gate changes
+# to the simulator.
+
+set -u
+
+usage() {
+    cat >&2 <<EOF
+Usage: $0 [-t "<threads>..."] [-e "<eco arguments>"]... [-m "<ranks>..."] [-s] [input...]
+  -t  thread counts, default "1 2 4"
+  -e  engine configuration to test, may be repeated; default: object,
+      --colored, strips, strips with --temporal 4, and cells
+  -m  also test the MPI build with these rank counts
+  -s  skip the trace checks
+  input is input<size> (checked against output<size>), default all of them
+EOF
+    exit 1
+}
+
+threads="1 2 4"
+configs=()
+ranks=""
+traces=1
+while getopts "t:e:m:sh" opt; do
+    case $opt in
+        t) threads=$OPTARG ;;
+        e) configs+=("$OPTARG") ;;
+        m) ranks=$OPTARG ;;
+        s) traces=0 ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ ${#configs[@]} -eq 0 ]; then
+    configs=("" "--colored" "--engine strips" "--engine strips --temporal 4" "--engine cells")
+fi
+
+here=$(cd "$(dirname "$0")" && pwd)
+if [ $# -gt 0 ]; then
+    inputs=$*
+else
+    inputs=$(cd "$here" && ls input* | sort)
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+CC=${CC:-gcc}
+MPICC=${MPICC:-mpicc}
+MPIRUN=${MPIRUN:-mpirun}
+$CC -O2 -fopenmp ${CFLAGS:-} -o "$work/eco" "$here/eco.c" || exit 1
+if [ -n "$ranks" ]; then
+    $MPICC -O2 -fopenmp -DUSE_MPI ${CFLAGS:-} -o "$work/eco_mpi" "$here/eco.c" || exit 1
+fi
+
+passed=0
+failed=0
+
+# check <description> <output> <reference>
+check() {
+    if cmp -s "$2" "$3"; then
+        passed=$((passed + 1))
+    else
+        failed=$((failed + 1))
+        echo "FAIL  $1"
+    fi
+}
+
+for input in $inputs; do
+    size=${input#input}
+    reference="$here/output$size"
+    if [ ! -f "$reference" ]; then
+        echo "SKIP  $input: no output$size"
+        continue
+    fi
+
+    for config in "${configs[@]}"; do
+        for t in $threads; do
+            OMP_NUM_THREADS=$t "$work/eco" $config "$here/$input" >"$work/out" 2>/dev/null
+            check "$input ${config:-object} threads=$t" "$work/out" "$reference"
+        done
+    done
+
+    # Checkpoint halfway, then finish the run from the checkpoint
+    read -r _ _ _ n_gen _ <"$here/$input"
+    if [ "$n_gen" -ge 2 ]; then
+        set -- $threads
+        rm -f "$work/checkpoint"
+        OMP_NUM_THREADS=$1 "$work/eco" --checkpoint $((n_gen / 2)) "$work/checkpoint" "$here/$input" >"$work/out" 2>/dev/null
+        check "$input checkpoint threads=$1" "$work/out" "$reference"
+        for t in $threads; do
+            OMP_NUM_THREADS=$t "$work/eco" --resume "$work/checkpoint" >"$work/out" 2>/dev/null
+            check "$input resume threads=$t" "$work/out" "$reference"
+        done
+    fi
+
+    for n in $ranks; do
+        $MPIRUN -np "$n" "$work/eco_mpi" "$here/$input" >"$work/out" 2>/dev/null
+        check "$input mpi ranks=$n" "$work/out" "$reference"
+    done
+
+    allgen="$here/allgen$size"
+    if [ $traces -eq 1 ] && [ -f "$allgen" ]; then
+        first=""
+        for t in $threads; do
+            OMP_NUM_THREADS=$t "$work/eco" --trace "$work/trace" "$here/$input" >/dev/null 2>&1
+            check "$input trace threads=$t" "$work/trace" "$allgen"
+            # Ids do not depend on the thread count either
+            OMP_NUM_THREADS=$t "$work/eco" --trace "$work/compact$t" --trace-compact "$here/$input" >/dev/null 2>&1
+            if [ -z "$first" ]; then
+                first=$t
+            else
+                check "$input compact trace threads=$t vs $first" "$work/compact$t" "$work/compact$first"
+            fi
+        done
+    fi
+    echo "done  $input"
+done
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]